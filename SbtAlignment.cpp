@@ -92,7 +92,7 @@ void SbtAlignment::overrideRoadWidth() {
     std::cout << "SbtAlignment::overrideRoadWidth() _roadWidth = "
               << _alignmentAlg->getRoadWidth(_alignmentAlg->getLoopIndex()) << " (cm) " << std::endl;
   }
-  _configurator->getMakeTracks()->getPatRecAlg()->overrideRoadWidth(_alignmentAlg->getRoadWidth(_alignmentAlg->getLoopIndex()));
+  _configurator->getMakeTracks()->overrideRoadWidth(_alignmentAlg->getRoadWidth(_alignmentAlg->getLoopIndex()));
 }
 
 void SbtAlignment::incrementLoopIndex() {
@@ -18,13 +18,15 @@ ClassImp(SbtBentCrystalPatRecAlg);
 
 SbtBentCrystalPatRecAlg::SbtBentCrystalPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID) : 
   SbtPatRecAlg(config, trackDetID),
-  _deflectionAngleThreshold(1e-4) {
+  _deflectionAngleThreshold(1e-4),
+  _maxDeflectionAngle(0) {
   if (getDebugLevel() > 0) {
     std::cout << "SbtBentCrystalPatRecAlg: DebugLevel= " << getDebugLevel() << std::endl;
   }
   assert(_trackDetID.size() >= 4);
   _algName = "BentCrystal";
   if (config["deflectionAngleThreshold"]) _deflectionAngleThreshold = config["deflectionAngleThreshold"].as<double>();
+  if (config["maxDeflectionAngle"]) _maxDeflectionAngle = config["maxDeflectionAngle"].as<double>();
 }
 
 int SbtBentCrystalPatRecAlg::_findLongTracks() {
@@ -32,24 +34,32 @@ int SbtBentCrystalPatRecAlg::_findLongTracks() {
   // create the candidate tracks with n SpacePoints
   // n = _nTrackDet, the number of tracking detectors
 
-  // define here the vector of SpacePoint iterators
-  std::vector<std::vector<SbtSpacePoint*>::const_iterator> SPIterator;
-  for (unsigned int i = 0; i < _nTrackDet; i++) {
-    SPIterator.push_back(std::vector<SbtSpacePoint *>::const_iterator());
-  }
+  // each pair of outer SpacePoints (first and last detector) is a seed: the
+  // seeds are searched in parallel and the tracks are built in seed order
+  // (only the pairs within the beam slope window, if there is one)
+  const std::vector<SbtSpacePoint*>& spListFront = _detSpacePointList[_trackDetID[0]];
+  const std::vector<SbtSpacePoint*>& spListBack = _detSpacePointList[_trackDetID[_nTrackDet - 1]];
+  CandidateList candidates;
+  runSeeds(makeSeeds(), [&](int seed, int worker, CandidateList& found) {
+    int iFront, iBack;
+    getSeed(seed, iFront, iBack);
+    // define here the vector of SpacePoint iterators
+    std::vector<std::vector<SbtSpacePoint*>::const_iterator> SPIterator(_nTrackDet);
+    SPIterator.front() = spListFront.begin() + iFront;
+    SPIterator.back() = spListBack.begin() + iBack;
+    // the road is fixed by the seed: the masks of all the inner planes are
+    // computed once, before the loops
+    fillRoadMasks(*SPIterator.front(), *SPIterator.back(), worker);
+    // loop on inner telescope detector SpacePoints
+    LoopOnSpacePoints(SPIterator, 1, worker, found);
+    return 0;
+  }, candidates);
 
-  // loop on outer telescope (first detector)  SpacePoints
-  for (SPIterator.front() = _detSpacePointList[_trackDetID[0]].begin();
-       SPIterator.front() != _detSpacePointList[_trackDetID[0]].end();
-       SPIterator.front()++) {
-    // loop on outer telescope (last detector)  SpacePoints
-    for (SPIterator.back() = _detSpacePointList[_trackDetID[_nTrackDet - 1]].begin();
-         SPIterator.back() != _detSpacePointList[_trackDetID[_nTrackDet - 1]].end();
-         SPIterator.back()++) {
-      // loop on inner telescope detector SpacePoints
-      ntracks = LoopOnSpacePoints(SPIterator, 1);
-    }  // close loop on outer detector, last one
-  }    // close loop on outer detector, first one
+  //  start to build the tracks using SpacePoints
+  for (auto& SPList : candidates) {
+    _currentEvent->AddTrack(SbtTrack(SPList, SbtEnums::objectType::reconstructed, SbtEnums::trackShape::longTrack));
+    ntracks++;
+  }
 
   if (getDebugLevel() > 1) {
     std::cout << "SbtBentCrystalPatRecAlg: ntracks = " << ntracks << std::endl;
@@ -61,13 +71,53 @@ int SbtBentCrystalPatRecAlg::_findChanneledTracks() {
   int ntracks = 0;
   auto dsTracks = _findDownstreamCandidates();
   auto usTracks = _findUpstreamCandidates();
+
+  // with a deflection window, the downstream segments are ordered by their
+  // angle in the x-z plane and each upstream segment only looks at those
+  // within the window in both projections
+  std::vector<std::pair<double, int> > dsAngleX;
+  std::vector<double> dsAngleY;
+  if (_maxDeflectionAngle > 0) {
+    dsAngleX.resize(dsTracks.size());
+    dsAngleY.resize(dsTracks.size());
+    for (unsigned int j = 0; j < dsTracks.size(); j++) {
+      TVector3 d = dsTracks[j][1]->point() - dsTracks[j][0]->point();
+      dsAngleX[j] = std::make_pair(atan2(d.X(), d.Z()), j);
+      dsAngleY[j] = atan2(d.Y(), d.Z());
+    }
+    std::sort(dsAngleX.begin(), dsAngleX.end());
+  }
+
+  std::vector<int> matches;
   for (auto& us: usTracks) {
     SbtLineSegment line1(us[0]->point(), us[1]->point());
-    for (auto& ds : dsTracks) {
+    matches.clear();
+    if (_maxDeflectionAngle > 0) {
+      TVector3 d = us[1]->point() - us[0]->point();
+      double angleX = atan2(d.X(), d.Z());
+      double angleY = atan2(d.Y(), d.Z());
+      auto first = std::lower_bound(dsAngleX.begin(), dsAngleX.end(),
+                                    std::make_pair(angleX - _maxDeflectionAngle, -1));
+      for (auto it = first; it != dsAngleX.end() && it->first <= angleX + _maxDeflectionAngle; ++it) {
+        if (fabs(dsAngleY[it->second] - angleY) <= _maxDeflectionAngle) matches.push_back(it->second);
+      }
+      // same order as the full loop
+      std::sort(matches.begin(), matches.end());
+    }
+    else {
+      matches.resize(dsTracks.size());
+      for (unsigned int j = 0; j < dsTracks.size(); j++) matches[j] = j;
+    }
+
+    for (int j : matches) {
+      auto& ds = dsTracks[j];
       SbtLineSegment line2(ds[0]->point(), ds[1]->point());
       if (line1.distance(line2) < _roadWidth) {
         double angle_yzplane = TMath::Abs(line1.angle_yzplane(line2));
         double angle_xzplane = TMath::Abs(line1.angle_xzplane(line2));
+        if (_maxDeflectionAngle > 0 && (angle_yzplane > _maxDeflectionAngle || angle_xzplane > _maxDeflectionAngle)) {
+          continue;
+        }
         auto trackShape = SbtEnums::trackShape::longTrack;
         if (angle_yzplane > _deflectionAngleThreshold && angle_xzplane > _deflectionAngleThreshold) {
           trackShape = SbtEnums::trackShape::channelledTrack;
@@ -141,6 +191,9 @@ int SbtBentCrystalPatRecAlg::_linkHits() {
   if (_currentEvent->GetSpacePointList().size() >= 4) {
     // Long and channelled track types require at least 4 space points
     _trkCounter += _findLongTracks();
+    // the event is dropped once the seeds are over budget, the other
+    // track types are not searched
+    if (budgetExceeded()) return _trkCounter;
     _trkCounter += _findChanneledTracks();
   }
   _trkCounter += _findDownStreamTracks();
@@ -149,29 +202,6 @@ int SbtBentCrystalPatRecAlg::_linkHits() {
   return _trkCounter;
 }
 
-bool SbtBentCrystalPatRecAlg::isInsideTrkRoad(SbtSpacePoint *sp0, SbtSpacePoint *sp3, SbtSpacePoint *spInternal) const {
-  TVector3 x0 = sp0->point();
-  TVector3 x3 = sp3->point();
-  TVector3 xInternal = spInternal->point();
-
-  bool passed = false;
-
-  SbtLineSegment line(x0, x3);
-  passed = line.distance(xInternal) < _roadWidth;
-  if (getDebugLevel() > 1) {
-    std::cout << "SbtBentCrystalPatRecAlg: Distance xInternal = "<< line.distance(xInternal) << std::endl;
-    std::cout << "x0   = ";
-    x0.Print();
-    std::cout << "x3   = ";
-    x3.Print();
-    std::cout << "xInt = ";
-    xInternal.Print();
-    std::cout << "passed = " << passed << std::endl;
-  }
-
-  return passed;
-}
-
 bool SbtBentCrystalPatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpacePoint *>::const_iterator> SPIter) const {
   bool passed = false;
 
@@ -220,7 +250,7 @@ bool SbtBentCrystalPatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpaceP
   passed = true;
 
   for (unsigned int i = 1; i < (_nTrackDet - 1); i++) {
-    if (line.distance(x.at(i)) > _roadWidth) {
+    if (line.distance(x.at(i)) > getRoadWidth(i)) {
       passed = false;
       break;
     }
@@ -236,41 +266,48 @@ bool SbtBentCrystalPatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpaceP
   return passed;
 }
 
-int SbtBentCrystalPatRecAlg::LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::const_iterator> &SPIter, unsigned int k) const {
-  int ntracks = 0;
+void SbtBentCrystalPatRecAlg::fillRoadMasks(const SbtSpacePoint* front, const SbtSpacePoint* back, int worker) {
+  // check which Internal SPs are within the track nominal road
+  SbtLineSegment line(front->point(), back->point());
+  for (unsigned int k = 1; k < _nTrackDet - 1; k++) {
+    int detID = _trackDetID[k];
+    int nSpacePoints = _detSpacePointList[detID].size();
+    line.pointsInRoad(nSpacePoints, _spX[detID].data(), _spY[detID].data(), _spZ[detID].data(), getRoadWidth(k),
+                      roadMask(worker, k, nSpacePoints));
+  }
+}
+
+void SbtBentCrystalPatRecAlg::LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::const_iterator> &SPIter, unsigned int k,
+                                                int worker, CandidateList& found) {
   if (getDebugLevel() > 1) {
     std::cout << "SbtBentCrystalPatRecAlg::LoopOnSpacePoints nested loop n. " << k << std::endl;
   }
 
-  // loop on inner telescope detector SpacePoints
+  int detID = _trackDetID[k];
+  int nSpacePoints = _detSpacePointList[detID].size();
+  uint64_t* inRoad = roadMask(worker, k, nSpacePoints);
 
-  for (SPIter[k] = _detSpacePointList[_trackDetID[k]].begin();
-       SPIter[k] != _detSpacePointList[_trackDetID[k]].end();
-       SPIter[k]++) {
-    // check if the Internal SP is within the track nominal road
-    // pay attention: SP ordering matters below
-
-    if (!isInsideTrkRoad(*SPIter.front(), *SPIter.back(), *SPIter[k])) continue;
+  // loop on inner telescope detector SpacePoints
+  for (int iSP = 0; iSP < nSpacePoints; iSP++) {
+    if (!SbtLineSegment::inMask(inRoad, iSP)) continue;
+    SPIter[k] = _detSpacePointList[detID].begin() + iSP;
 
     if ((_nTrackDet - 2) == k) {
       bool isGoodTrack = isCandidateTrack(SPIter);
 
       if (isGoodTrack) {
-        //  start to build the tracks using SpacePoints
         std::vector<SbtSpacePoint*> SPList;
         for (unsigned int i = 0; i < _nTrackDet; i++) {
           SPList.push_back(*SPIter.at(i));
         }
-        _currentEvent->AddTrack(SbtTrack(SPList, SbtEnums::objectType::reconstructed, SbtEnums::trackShape::longTrack));
-        ntracks++;
+        found.push_back(SPList);
       }
     }
 
     if (k < (_nTrackDet - 2)) {
-      ntracks += LoopOnSpacePoints(SPIter, k + 1);
+      LoopOnSpacePoints(SPIter, k + 1, worker, found);
     }
   }
-  return ntracks;
 }
 
 void SbtBentCrystalPatRecAlg::SortSpacePoints(std::vector<SbtSpacePoint*> &SPList) const {
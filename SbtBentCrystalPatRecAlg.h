@@ -20,10 +20,13 @@ class SbtBentCrystalPatRecAlg : public SbtPatRecAlg {
 
  protected:
   bool isCandidateTrack(std::vector<std::vector<SbtSpacePoint*>::const_iterator> SPIter) const;
-  bool isInsideTrkRoad(SbtSpacePoint* outerSpacePoint0, SbtSpacePoint* outerSpacePoint1, SbtSpacePoint* innerSpacePoint) const;
   void SortSpacePoints(std::vector<SbtSpacePoint*>& SPList) const;
   void SortDetectorElems(std::vector<SbtDetectorElem*>& DEList);
-  int LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::const_iterator>& SPIter, unsigned int k) const;
+  // road masks of the inner planes of the worker for the seed front, back
+  void fillRoadMasks(const SbtSpacePoint* front, const SbtSpacePoint* back, int worker);
+  // add the candidates with the outer space points of SPIter to found
+  void LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::const_iterator>& SPIter, unsigned int k,
+                         int worker, CandidateList& found);
   int _linkHits();
   int _findLongTracks();
   int _findChanneledTracks();
@@ -34,6 +37,7 @@ class SbtBentCrystalPatRecAlg : public SbtPatRecAlg {
 
   int _trkCounter;
   double _deflectionAngleThreshold;
+  double _maxDeflectionAngle;  // largest up/downstream angle in each projection, 0 for no limit
 
   ClassDef(SbtBentCrystalPatRecAlg, 1);
 };
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <TVector3.h>
+
+#include "SbtCKFPatRecAlg.h"
+#include "SbtDetectorElem.h"
+#include "SbtDetectorType.h"
+#include "SbtEvent.h"
+#include "SbtMultipleScattering.h"
+#include "SbtSpacePoint.h"
+#include "SbtTrack.h"
+
+ClassImp(SbtCKFPatRecAlg);
+
+SbtCKFPatRecAlg::SbtCKFPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID)
+    : SbtPatRecAlg(config, trackDetID), _planesInitialized(false) {
+  if (getDebugLevel() > 0) {
+    std::cout << "SbtCKFPatRecAlg: DebugLevel= " << getDebugLevel() << std::endl;
+  }
+  assert(_trackDetID.size() >= 3);
+  assert(_trackDetID.size() <= maxTrkNSpacePoint);
+  _algName = "CKF";
+
+  _beamEnergy = config["beamEnergy"] ? config["beamEnergy"].as<double>() : 0.;
+  _maxBranches = config["maxBranches"] ? config["maxBranches"].as<int>() : 3;
+  _maxChi2 = config["maxChi2"] ? config["maxChi2"].as<double>() : 9.;
+  assert(_maxBranches > 0);
+  assert(_maxChi2 > 0);
+}
+
+// the multiple scattering of each plane is evaluated once, from the
+// material and thickness of the detector elements
+void SbtCKFPatRecAlg::initializePlanes() {
+  for (int k = 0; k < _nTrackDet; k++) {
+    _msSlopeVar[k] = 0;
+    if (_beamEnergy <= 0) continue;
+    const SbtDetectorElem* detElem = _detSpacePointList[_trackDetID[k]].front()->GetDetectorElem();
+    double thickness = 2 * detElem->GetDetectorType()->GetZ_HalfDim();
+    double radLen = detElem->GetRadLen();
+    if (radLen <= 0) continue;
+    double theta0 = SbtMultipleScattering::MultipleScatteringAngleSigma(_beamEnergy, thickness, radLen);
+    _msSlopeVar[k] = theta0 * theta0;
+    if (getDebugLevel() > 0) {
+      std::cout << "SbtCKFPatRecAlg: plane " << k << " theta0 = " << theta0 << std::endl;
+    }
+  }
+  _planesInitialized = true;
+}
+
+void SbtCKFPatRecAlg::pointErrors(SbtSpacePoint* sp, double* err2) const {
+  // the road width is used for space points without errors
+  double err[2] = {sp->GetXPositionErr(), sp->GetYPositionErr()};
+  for (int p = 0; p < 2; p++) {
+    if (err[p] <= 0) err[p] = _roadWidth;
+    err2[p] = err[p] * err[p];
+  }
+}
+
+void SbtCKFPatRecAlg::seedBranch(SbtSpacePoint* sp0, SbtSpacePoint* sp1, ckfBranch& branch) const {
+  TVector3 x0 = sp0->point();
+  TVector3 x1 = sp1->point();
+  double err2_0[2], err2_1[2];
+  pointErrors(sp0, err2_0);
+  pointErrors(sp1, err2_1);
+  double dz = x1.Z() - x0.Z();
+  for (int p = 0; p < 2; p++) {
+    branch._pos[p] = x1[p];
+    branch._slope[p] = (x1[p] - x0[p]) / dz;
+    branch._cov[p][0] = err2_1[p];
+    branch._cov[p][1] = err2_1[p] / dz;
+    branch._cov[p][2] = (err2_0[p] + err2_1[p]) / (dz * dz);
+  }
+  branch._z = x1.Z();
+  branch._chi2 = 0;
+  branch._spacePoints[0] = sp0;
+  branch._spacePoints[1] = sp1;
+}
+
+bool SbtCKFPatRecAlg::updateBranch(const ckfBranch& branch, SbtSpacePoint* sp, int plane,
+                                   ckfBranch& newBranch) const {
+  TVector3 x = sp->point();
+  double err2[2];
+  pointErrors(sp, err2);
+  double dz = x.Z() - branch._z;
+
+  double chi2 = 0;
+  for (int p = 0; p < 2; p++) {
+    // scattering in the previous plane, then straight line propagation
+    double cxx = branch._cov[p][0];
+    double cxt = branch._cov[p][1];
+    double ctt = branch._cov[p][2] + _msSlopeVar[plane - 1];
+    double pos = branch._pos[p] + branch._slope[p] * dz;
+    cxx += 2 * dz * cxt + dz * dz * ctt;
+    cxt += dz * ctt;
+
+    // Kalman update with the measured position
+    double s = cxx + err2[p];
+    double r = x[p] - pos;
+    chi2 += r * r / s;
+    double k0 = cxx / s;
+    double k1 = cxt / s;
+    newBranch._pos[p] = pos + k0 * r;
+    newBranch._slope[p] = branch._slope[p] + k1 * r;
+    newBranch._cov[p][0] = cxx - k0 * cxx;
+    newBranch._cov[p][1] = cxt - k0 * cxt;
+    newBranch._cov[p][2] = ctt - k1 * cxt;
+  }
+  if (chi2 > _maxChi2) return false;
+
+  newBranch._z = x.Z();
+  newBranch._chi2 = branch._chi2 + chi2;
+  std::copy(branch._spacePoints, branch._spacePoints + plane, newBranch._spacePoints);
+  newBranch._spacePoints[plane] = sp;
+  return true;
+}
+
+int SbtCKFPatRecAlg::_linkHits() {
+  // reset all the lists
+  for (int i = 0; i < maxNTelescopeDetector; i++) {
+    _detSpacePointList[i].clear();
+  }
+  // _trackDetID contains the telescope DetectorElemID ordered according to z
+  if (getDebugLevel()) {
+    std::cout << "SbtCKFPatRecAlg::linkHits " << std::endl;
+  }
+
+  int trkCounter = 0;
+  // tracks with space points on all Telescope Det are selected
+  if (_currentEvent->GetSpacePointList().size() < _trackDetID.size()) {
+    if (getDebugLevel()) {
+      std::cout << "WARNING: #" << _currentEvent->GetSpacePointList().size() << " Spacepoints found."
+           << "Skip the event" << std::endl;
+    }
+    return 0;
+  }
+
+  if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
+  if (!_planesInitialized) initializePlanes();
+
+  // bin the planes after the seed and find their largest point error, used
+  // to open the search window around the predicted position
+  double maxPointVar[maxNTelescopeDetector];
+  for (int k = 2; k < _nTrackDet; k++) {
+    std::vector<SbtSpacePoint*>& spList = _detSpacePointList[_trackDetID[k]];
+    _grid[k].fill(spList, _roadWidth);
+    maxPointVar[k] = 0;
+    for (auto sp : spList) {
+      double err2[2];
+      pointErrors(sp, err2);
+      maxPointVar[k] = std::max(maxPointVar[k], std::max(err2[0], err2[1]));
+    }
+  }
+
+  int nBranches = 0;
+  auto lessChi2 = [](const ckfBranch& a, const ckfBranch& b) { return a._chi2 < b._chi2; };
+  for (auto sp0 : _detSpacePointList[_trackDetID[0]]) {
+    if (outOfTime()) break;
+    for (auto sp1 : _detSpacePointList[_trackDetID[1]]) {
+      _branches.resize(1);
+      seedBranch(sp0, sp1, _branches.front());
+
+      for (int k = 2; k < _nTrackDet && !_branches.empty(); k++) {
+        std::vector<SbtSpacePoint*>& spList = _detSpacePointList[_trackDetID[k]];
+        _newBranches.clear();
+        for (auto& branch : _branches) {
+          // search window around the prediction at the plane
+          double dz = _grid[k].getZ() - branch._z;
+          double x = branch._pos[0] + branch._slope[0] * dz;
+          double y = branch._pos[1] + branch._slope[1] * dz;
+          double maxVar = 0;
+          for (int p = 0; p < 2; p++) {
+            double ctt = branch._cov[p][2] + _msSlopeVar[k - 1];
+            maxVar = std::max(maxVar, branch._cov[p][0] + 2 * dz * branch._cov[p][1] + dz * dz * ctt);
+          }
+          double slope = sqrt(branch._slope[0] * branch._slope[0] + branch._slope[1] * branch._slope[1]);
+          double radius = sqrt(_maxChi2 * (maxVar + maxPointVar[k])) + slope * _grid[k].getDeltaZ();
+
+          _candidates.clear();
+          _grid[k].findCandidates(x, y, radius, _candidates);
+          for (int iCandidate : _candidates) {
+            ckfBranch newBranch;
+            if (updateBranch(branch, spList[iCandidate], k, newBranch)) {
+              _newBranches.push_back(newBranch);
+            }
+          }
+        }
+        nBranches += _newBranches.size();
+
+        // keep the best branches only
+        if ((int)_newBranches.size() > _maxBranches) {
+          std::partial_sort(_newBranches.begin(), _newBranches.begin() + _maxBranches, _newBranches.end(),
+                            lessChi2);
+          _newBranches.resize(_maxBranches);
+        }
+        _branches.swap(_newBranches);
+      }
+      if (_branches.empty()) continue;
+
+      // the best branch of the seed becomes a track candidate
+      auto best = std::min_element(_branches.begin(), _branches.end(), lessChi2);
+      std::vector<SbtSpacePoint*> SPList(best->_spacePoints, best->_spacePoints + _nTrackDet);
+      _currentEvent->AddTrack(SbtTrack(SPList));
+      trkCounter++;
+
+      if (getDebugLevel() > 1) {
+        std::cout << "SbtCKFPatRecAlg: new track, chi2 = " << best->_chi2 << std::endl;
+      }
+    }
+  }
+
+  if (getDebugLevel() > 1) {
+    std::cout << "SbtCKFPatRecAlg: branches = " << nBranches << std::endl;
+    std::cout << "SbtCKFPatRecAlg: trkCounter = " << trkCounter << std::endl;
+  }
+  return trkCounter;
+}
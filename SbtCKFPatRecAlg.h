@@ -0,0 +1,65 @@
+#ifndef SBTCKFPATRECALG_HH
+#define SBTCKFPATRECALG_HH
+
+#include <vector>
+
+#include "SbtDef.h"
+#include "SbtPatRecAlg.h"
+#include "SbtSpacePointGrid.h"
+
+class SbtEvent;
+class SbtTrack;
+class SbtSpacePoint;
+class SbtDetectorElem;
+
+//
+// Description
+//
+// combinatorial Kalman filter pattern recognition: tracks are seeded with
+// the space points of the first two tracking planes, then propagated plane
+// by plane as straight lines, with the multiple scattering of the crossed
+// detectors added to the slope covariance. On each plane the space points
+// compatible with the predicted state are added with a Kalman update and
+// only the best branches (lowest chi2) are kept.
+
+class SbtCKFPatRecAlg : public SbtPatRecAlg {
+ public:
+  SbtCKFPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID);
+  ~SbtCKFPatRecAlg() {;}
+
+ protected:
+  // track state in the x-z and y-z projections: position, slope and the
+  // covariance (pos-pos, pos-slope, slope-slope), at _z
+  struct ckfBranch {
+    double _pos[2];
+    double _slope[2];
+    double _cov[2][3];
+    double _z;
+    double _chi2;
+    SbtSpacePoint* _spacePoints[maxTrkNSpacePoint];
+  };
+
+  int _linkHits();
+  void initializePlanes();
+  void seedBranch(SbtSpacePoint* sp0, SbtSpacePoint* sp1, ckfBranch& branch) const;
+  // predict the branch to the space point z and add it; returns false if
+  // the chi2 increment is above _maxChi2
+  bool updateBranch(const ckfBranch& branch, SbtSpacePoint* sp, int plane, ckfBranch& newBranch) const;
+  void pointErrors(SbtSpacePoint* sp, double* err2) const;
+
+  double _beamEnergy;  // MeV, no multiple scattering if not set
+  int _maxBranches;    // branches kept on each plane
+  double _maxChi2;     // chi2 increment allowed on each plane
+
+  bool _planesInitialized;
+  double _msSlopeVar[maxNTelescopeDetector];  // slope variance added by each plane
+
+  SbtSpacePointGrid _grid[maxNTelescopeDetector];
+  std::vector<int> _candidates;
+  std::vector<ckfBranch> _branches;
+  std::vector<ckfBranch> _newBranches;
+
+  ClassDef(SbtCKFPatRecAlg, 1);
+};
+
+#endif
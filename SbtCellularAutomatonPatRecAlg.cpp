@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <TVector3.h>
+
+#include "SbtCellularAutomatonPatRecAlg.h"
+#include "SbtDetectorElem.h"
+#include "SbtEvent.h"
+#include "SbtLineSegment.h"
+#include "SbtSpacePoint.h"
+#include "SbtTrack.h"
+
+ClassImp(SbtCellularAutomatonPatRecAlg);
+
+SbtCellularAutomatonPatRecAlg::SbtCellularAutomatonPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID)
+    : SbtPatRecAlg(config, trackDetID), _trkCounter(0) {
+  if (getDebugLevel() > 0) {
+    std::cout << "SbtCellularAutomatonPatRecAlg: DebugLevel= " << getDebugLevel() << std::endl;
+  }
+  assert(_trackDetID.size() >= 3);
+  _algName = "CellularAutomaton";
+
+  _maxSlope = config["caMaxSlope"] ? config["caMaxSlope"].as<double>() : 0.01;
+  _maxKink = config["caMaxKink"] ? config["caMaxKink"].as<double>() : 0.;
+  assert(_maxSlope > 0);
+}
+
+void SbtCellularAutomatonPatRecAlg::makeDoublets(int gap) {
+  std::vector<SbtSpacePoint*>& innerList = _detSpacePointList[_trackDetID[gap]];
+  std::vector<SbtSpacePoint*>& outerList = _detSpacePointList[_trackDetID[gap + 1]];
+  const SbtSpacePointGrid& outerGrid = _grid[gap + 1];
+
+  _doubletInner[gap].clear();
+  _doubletOuter[gap].clear();
+  _doubletSlopeX[gap].clear();
+  _doubletSlopeY[gap].clear();
+  for (unsigned int i = 0; i < innerList.size(); i++) {
+    TVector3 x0 = innerList[i]->point();
+    // all the space points within the slope range are in this window
+    double radius = _maxSlope * (fabs(outerGrid.getZ() - x0.Z()) + outerGrid.getDeltaZ());
+    _candidates.clear();
+    outerGrid.findCandidates(x0.X(), x0.Y(), radius, _candidates);
+    std::sort(_candidates.begin(), _candidates.end());
+    for (int j : _candidates) {
+      TVector3 x1 = outerList[j]->point();
+      double dz = x1.Z() - x0.Z();
+      double slopeX = (x1.X() - x0.X()) / dz;
+      double slopeY = (x1.Y() - x0.Y()) / dz;
+      if (fabs(slopeX) > _maxSlope || fabs(slopeY) > _maxSlope) continue;
+      _doubletInner[gap].push_back(i);
+      _doubletOuter[gap].push_back(j);
+      _doubletSlopeX[gap].push_back(slopeX);
+      _doubletSlopeY[gap].push_back(slopeY);
+    }
+  }
+
+  // index the doublets by outer space point (counting sort)
+  int nDoublets = _doubletInner[gap].size();
+  _byOuterStart[gap].assign(outerList.size() + 1, 0);
+  for (int d = 0; d < nDoublets; d++) {
+    _byOuterStart[gap][_doubletOuter[gap][d] + 1]++;
+  }
+  for (unsigned int j = 0; j < outerList.size(); j++) {
+    _byOuterStart[gap][j + 1] += _byOuterStart[gap][j];
+  }
+  std::vector<int> next(_byOuterStart[gap].begin(), _byOuterStart[gap].end() - 1);
+  _byOuter[gap].resize(nDoublets);
+  for (int d = 0; d < nDoublets; d++) {
+    _byOuter[gap][next[_doubletOuter[gap][d]]++] = d;
+  }
+  _doubletState[gap].assign(nDoublets, 1);
+}
+
+// inner is a doublet of gap - 1 and outer a doublet of gap, sharing a
+// space point: the triplet is accepted if the kink is within _maxKink or,
+// by default, if the outer doublet stays within the road of plane gap
+// around the extrapolation of the inner one
+bool SbtCellularAutomatonPatRecAlg::areNeighbours(int gap, int inner, int outer) const {
+  double dSlopeX = _doubletSlopeX[gap][outer] - _doubletSlopeX[gap - 1][inner];
+  double dSlopeY = _doubletSlopeY[gap][outer] - _doubletSlopeY[gap - 1][inner];
+  double kink = sqrt(dSlopeX * dSlopeX + dSlopeY * dSlopeY);
+  if (_maxKink > 0) return kink < _maxKink;
+
+  const SbtSpacePoint* sp0 = _detSpacePointList[_trackDetID[gap]][_doubletInner[gap][outer]];
+  const SbtSpacePoint* sp1 = _detSpacePointList[_trackDetID[gap + 1]][_doubletOuter[gap][outer]];
+  return kink * fabs(sp1->GetZPosition() - sp0->GetZPosition()) < getRoadWidth(gap);
+}
+
+// the state of a doublet is one more than the largest state of its
+// neighbours on the previous gap
+void SbtCellularAutomatonPatRecAlg::evolveStates(int gap) {
+  int nDoublets = _doubletInner[gap].size();
+  const std::vector<int>& start = _byOuterStart[gap - 1];
+  const std::vector<int>& byOuter = _byOuter[gap - 1];
+  const std::vector<int>& innerState = _doubletState[gap - 1];
+  std::vector<int>& state = _doubletState[gap];
+  for (int d = 0; d < nDoublets; d++) {
+    int sp = _doubletInner[gap][d];
+    for (int n = start[sp]; n < start[sp + 1]; n++) {
+      int dInner = byOuter[n];
+      if (innerState[dInner] + 1 > state[d] && areNeighbours(gap, dInner, d)) {
+        state[d] = innerState[dInner] + 1;
+      }
+    }
+  }
+}
+
+void SbtCellularAutomatonPatRecAlg::followChain(int gap, int d) {
+  _chain[gap + 1] = _detSpacePointList[_trackDetID[gap + 1]][_doubletOuter[gap][d]];
+  _chain[gap] = _detSpacePointList[_trackDetID[gap]][_doubletInner[gap][d]];
+  if (gap == 0) {
+    // the chains may branch many times in dense events, the time budget
+    // is checked on each of them
+    if (outOfTime()) return;
+    if (isCandidateTrack()) {
+      _currentEvent->AddTrack(SbtTrack(_chain));
+      _trkCounter++;
+    }
+    return;
+  }
+  int sp = _doubletInner[gap][d];
+  for (int n = _byOuterStart[gap - 1][sp]; n < _byOuterStart[gap - 1][sp + 1]; n++) {
+    int dInner = _byOuter[gap - 1][n];
+    if (budgetExceeded()) return;
+    if (_doubletState[gap - 1][dInner] == _doubletState[gap][d] - 1 && areNeighbours(gap, dInner, d)) {
+      followChain(gap - 1, dInner);
+    }
+  }
+}
+
+bool SbtCellularAutomatonPatRecAlg::isCandidateTrack() const {
+  // the inner space points must be in the road of the outer ones
+  SbtLineSegment line(_chain.front()->point(), _chain.back()->point());
+  for (int k = 1; k < _nTrackDet - 1; k++) {
+    if (line.distance(_chain[k]->point()) > getRoadWidth(k)) return false;
+  }
+  return true;
+}
+
+int SbtCellularAutomatonPatRecAlg::_linkHits() {
+  // reset all the lists
+  for (int i = 0; i < maxNTelescopeDetector; i++) {
+    _detSpacePointList[i].clear();
+  }
+  // _trackDetID contains the telescope DetectorElemID ordered according to z
+  if (getDebugLevel()) {
+    std::cout << "SbtCellularAutomatonPatRecAlg::linkHits " << std::endl;
+  }
+
+  _trkCounter = 0;
+  // tracks with space points on all Telescope Det are selected
+  if (_currentEvent->GetSpacePointList().size() < _trackDetID.size()) {
+    if (getDebugLevel()) {
+      std::cout << "WARNING: #" << _currentEvent->GetSpacePointList().size() << " Spacepoints found."
+           << "Skip the event" << std::endl;
+    }
+    return 0;
+  }
+
+  if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
+
+  int nGaps = _nTrackDet - 1;
+  for (int k = 1; k < _nTrackDet; k++) {
+    _grid[k].fill(_detSpacePointList[_trackDetID[k]], _roadWidth);
+  }
+  int nDoublets = 0;
+  for (int gap = 0; gap < nGaps; gap++) {
+    makeDoublets(gap);
+    nDoublets += _doubletInner[gap].size();
+  }
+  for (int gap = 1; gap < nGaps; gap++) {
+    evolveStates(gap);
+  }
+
+  // the chains through all the planes end on a doublet of the last gap
+  // with the largest state
+  _chain.resize(_nTrackDet);
+  for (unsigned int d = 0; d < _doubletInner[nGaps - 1].size(); d++) {
+    if (outOfTime()) break;
+    if (_doubletState[nGaps - 1][d] == nGaps) followChain(nGaps - 1, d);
+  }
+
+  if (getDebugLevel() > 1) {
+    std::cout << "SbtCellularAutomatonPatRecAlg: doublets = " << nDoublets << std::endl;
+    std::cout << "SbtCellularAutomatonPatRecAlg: trkCounter = " << _trkCounter << std::endl;
+  }
+  return _trkCounter;
+}
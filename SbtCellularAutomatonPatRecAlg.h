@@ -0,0 +1,62 @@
+#ifndef SBTCELLULARAUTOMATONPATRECALG_HH
+#define SBTCELLULARAUTOMATONPATRECALG_HH
+
+#include <vector>
+
+#include "SbtDef.h"
+#include "SbtPatRecAlg.h"
+#include "SbtSpacePointGrid.h"
+
+class SbtEvent;
+class SbtTrack;
+class SbtSpacePoint;
+class SbtDetectorElem;
+
+//
+// Description
+//
+// cellular automaton pattern recognition: doublets (cells) are made of two
+// space points on adjacent tracking planes, and two cells sharing a space
+// point are neighbours if they form a triplet with a small kink. The state
+// of each cell is the length of the longest chain of neighbours ending in
+// it; the chains through all the tracking planes are the track candidates.
+// Each stage is a flat loop over the cells of one pair of planes.
+
+class SbtCellularAutomatonPatRecAlg : public SbtPatRecAlg {
+ public:
+  SbtCellularAutomatonPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID);
+  ~SbtCellularAutomatonPatRecAlg() {;}
+
+ protected:
+  int _linkHits();
+  void makeDoublets(int gap);
+  void evolveStates(int gap);
+  bool areNeighbours(int gap, int inner, int outer) const;
+  void followChain(int gap, int doublet);
+  bool isCandidateTrack() const;
+
+  double _maxSlope;  // largest doublet slope in each projection
+  double _maxKink;   // largest slope difference of a triplet, 0 to use the road width
+
+  SbtSpacePointGrid _grid[maxNTelescopeDetector];
+
+  // doublets between the planes gap and gap + 1: the space point indices,
+  // the slopes and the cellular automaton state
+  std::vector<int> _doubletInner[maxNTelescopeDetector];
+  std::vector<int> _doubletOuter[maxNTelescopeDetector];
+  std::vector<double> _doubletSlopeX[maxNTelescopeDetector];
+  std::vector<double> _doubletSlopeY[maxNTelescopeDetector];
+  std::vector<int> _doubletState[maxNTelescopeDetector];
+  // doublets of each gap ordered by outer space point:
+  // _byOuter[_byOuterStart[i].._byOuterStart[i+1]] end on space point i
+  std::vector<int> _byOuterStart[maxNTelescopeDetector];
+  std::vector<int> _byOuter[maxNTelescopeDetector];
+
+  std::vector<int> _candidates;
+  std::vector<SbtSpacePoint*> _chain;
+  int _trkCounter;
+
+  ClassDef(SbtCellularAutomatonPatRecAlg, 1);
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <yaml-cpp/yaml.h>
+
+#include "SbtChannelMask.h"
+#include "SbtDetectorElem.h"
+#include "SbtDetectorType.h"
+#include "SbtDigi.h"
+#include "SbtIO.h"
+
+ClassImp(SbtChannelMask);
+
+SbtChannelMask::SbtChannelMask()
+    : _debugLevel(0),
+      _name(),
+      _maskPath(),
+      _learnEvents(0),
+      _maxOccupancy(1.),
+      _nEvents(0) {
+  std::cout << "SbtChannelMask:  DebugLevel= " << _debugLevel << std::endl;
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    _nColumns[iDet] = 0;
+  }
+}
+
+void SbtChannelMask::initialize(std::string name, std::string maskPath, int learnEvents, double maxOccupancy) {
+  _name = name;
+  _maskPath = maskPath;
+  _learnEvents = learnEvents;
+  _maxOccupancy = maxOccupancy;
+  _nEvents = 0;
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    for (int iSide = 0; iSide < 2; iSide++) {
+      _counts[iDet][iSide].clear();
+      _mask[iDet][iSide].clear();
+    }
+  }
+}
+
+unsigned int SbtChannelMask::channel(const SbtDigi& digi) {
+  if (digi.GetType() == SbtEnums::pixel) {
+    return digi.GetRow() * digi.GetDetectorElem()->GetDetectorType()->GetNColumn() + digi.GetColumn();
+  }
+  return digi.GetChannelNumber();
+}
+
+int SbtChannelMask::side(const SbtDigi& digi) {
+  return digi.GetType() == SbtEnums::pixel ? 0 : digi.GetSide();
+}
+
+bool SbtChannelMask::isMasked(const SbtDigi& digi) const {
+  unsigned int ch = channel(digi);
+  const std::vector<uint64_t>& mask = _mask[digi.GetLayer()][side(digi)];
+  return (ch >> 6) < mask.size() && ((mask[ch >> 6] >> (ch & 63)) & 1);
+}
+
+void SbtChannelMask::fill(const SbtDigi& digi) {
+  assert(digi.GetLayer() < maxNDetector);
+  std::vector<unsigned int>& counts = _counts[digi.GetLayer()][side(digi)];
+  unsigned int ch = channel(digi);
+  if (ch >= counts.size()) counts.resize(ch + 1, 0);
+  ++counts[ch];
+  if (digi.GetType() == SbtEnums::pixel) {
+    _nColumns[digi.GetLayer()] = digi.GetDetectorElem()->GetDetectorType()->GetNColumn();
+  }
+}
+
+void SbtChannelMask::endEvent() {
+  if (!isLearning()) return;
+  ++_nEvents;
+  if (isLearning()) return;
+
+  // learning is over: build and save the mask
+  _applyOccupancy();
+  print();
+  writeMask();
+}
+
+void SbtChannelMask::_applyOccupancy() {
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    for (int iSide = 0; iSide < 2; iSide++) {
+      std::vector<unsigned int>& counts = _counts[iDet][iSide];
+      for (unsigned int ch = 0; ch < counts.size(); ch++) {
+        double occupancy = double(counts[ch]) / _nEvents;
+        if (occupancy > _maxOccupancy) {
+          if (_debugLevel > 0) {
+            std::cout << "SbtChannelMask: masking det " << iDet << " side " << iSide
+                      << " channel " << ch << ", occupancy " << occupancy << std::endl;
+          }
+          maskChannel(iDet, iSide, ch);
+        }
+      }
+      counts.clear();
+    }
+  }
+}
+
+void SbtChannelMask::maskChannel(int detId, int side, unsigned int channel) {
+  assert(detId < maxNDetector && side < 2);
+  std::vector<uint64_t>& mask = _mask[detId][side];
+  if ((channel >> 6) >= mask.size()) mask.resize((channel >> 6) + 1, 0);
+  mask[channel >> 6] |= uint64_t(1) << (channel & 63);
+}
+
+int SbtChannelMask::getNMasked() const {
+  int nMasked = 0;
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    for (int iSide = 0; iSide < 2; iSide++) {
+      for (auto word : _mask[iDet][iSide]) nMasked += __builtin_popcountll(word);
+    }
+  }
+  return nMasked;
+}
+
+void SbtChannelMask::print() const {
+  std::cout << "SbtChannelMask: " << getNMasked() << " channels masked";
+  if (_learnEvents > 0) std::cout << " after " << _nEvents << " events";
+  std::cout << std::endl;
+}
+
+bool SbtChannelMask::readMask() {
+  std::cout << "SbtChannelMask::readMask" << std::endl;
+  std::stringstream fileName;
+  fileName << _maskPath << "/" << _name << ".yaml";
+  std::cout << "Mask file: '" << fileName.str() << "'" << std::endl;
+  std::ifstream file(fileName.str());
+  if (!file.good()) {
+    std::cout << "Mask file not found" << std::endl;
+    return false;
+  }
+  file.close();
+  YAML::Node yamlMaskList = YAML::LoadFile(fileName.str().c_str());
+  for (auto mask : yamlMaskList) {
+    int detId = mask["id"].as<int>();
+    if (mask["pixels"]) {
+      _nColumns[detId] = mask["nColumns"].as<int>();
+      for (auto pixel : mask["pixels"]) {
+        // pixels are stored as [row, column]
+        auto rowCol = pixel.as<std::vector<unsigned int>>();
+        maskChannel(detId, 0, rowCol[0] * _nColumns[detId] + rowCol[1]);
+      }
+    }
+    else {
+      int side = mask["side"].as<int>();
+      for (auto ch : mask["channels"].as<std::vector<unsigned int>>()) {
+        maskChannel(detId, side, ch);
+      }
+    }
+  }
+  _nEvents = _learnEvents;
+  print();
+  return true;
+}
+
+void SbtChannelMask::writeMask() const {
+  std::cout << "SbtChannelMask::writeMask" << std::endl;
+  if (!SbtIO::createPath(_maskPath)) {
+    std::cout << "Could not create path '" << _maskPath << "'" << std::endl;
+    return;
+  }
+  std::stringstream fileName;
+  fileName << _maskPath << "/" << _name << ".yaml";
+  YAML::Node yamlMaskList(YAML::NodeType::Sequence);
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    for (int iSide = 0; iSide < 2; iSide++) {
+      const std::vector<uint64_t>& mask = _mask[iDet][iSide];
+      std::vector<unsigned int> channels;
+      for (unsigned int iWord = 0; iWord < mask.size(); iWord++) {
+        for (unsigned int iBit = 0; iBit < 64; iBit++) {
+          if ((mask[iWord] >> iBit) & 1) channels.push_back(iWord * 64 + iBit);
+        }
+      }
+      if (channels.empty()) continue;
+      YAML::Node yamlMask(YAML::NodeType::Map);
+      yamlMask["id"] = iDet;
+      if (_nColumns[iDet] > 0) {
+        // pixels are written back as row/column pairs
+        unsigned int nColumns = _nColumns[iDet];
+        yamlMask["nColumns"] = nColumns;
+        for (auto ch : channels) {
+          YAML::Node pixel;
+          pixel.push_back(ch / nColumns);
+          pixel.push_back(ch % nColumns);
+          pixel.SetStyle(YAML::EmitterStyle::Flow);
+          yamlMask["pixels"].push_back(pixel);
+        }
+      }
+      else {
+        yamlMask["side"] = iSide;
+        yamlMask["channels"] = channels;
+        yamlMask["channels"].SetStyle(YAML::EmitterStyle::Flow);
+      }
+      yamlMaskList.push_back(yamlMask);
+    }
+  }
+  std::ofstream file(fileName.str());
+  file << yamlMaskList;
+  file.close();
+}
@@ -0,0 +1,65 @@
+#ifndef SBT_CHANNELMASK
+#define SBT_CHANNELMASK
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "SbtDef.h"
+
+class SbtDigi;
+
+// mask of noisy strips and hot pixels
+// the mask is either loaded from a yaml file or learned online from the
+// per-channel occupancy over the first events, and then saved to file.
+// channels are addressed by detector id and side (0 for pixels);
+// the pixel channel is row * nColumns + column
+
+class SbtChannelMask {
+ public:
+  SbtChannelMask();
+  ~SbtChannelMask() {;}
+
+  void initialize(std::string name, std::string maskPath, int learnEvents, double maxOccupancy);
+  void setDebugLevel(int debugLevel) { _debugLevel = debugLevel; }
+  int getDebugLevel() const { return _debugLevel; }
+
+  // I/O
+  bool readMask();
+  void writeMask() const;
+
+  // occupancy learning: fill each digi, then close the event
+  bool isLearning() const { return _nEvents < _learnEvents; }
+  void fill(const SbtDigi& digi);
+  void endEvent();
+
+  bool isMasked(const SbtDigi& digi) const;
+
+  void maskChannel(int detId, int side, unsigned int channel);
+  int getNMasked() const;
+  void print() const;
+
+ protected:
+  static unsigned int channel(const SbtDigi& digi);
+  static int side(const SbtDigi& digi);
+
+  // build the mask from the accumulated occupancy
+  void _applyOccupancy();
+
+  int _debugLevel;
+  std::string _name;
+  std::string _maskPath;
+  int _learnEvents;
+  double _maxOccupancy;  // maximum fraction of events in which a channel may fire
+  int _nEvents;
+
+  std::vector<unsigned int> _counts[maxNDetector][2];
+  std::vector<uint64_t> _mask[maxNDetector][2];
+  int _nColumns[maxNDetector];  // pixel detectors only, 0 for strips
+
+  ClassDef(SbtChannelMask, 1);
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <TView3D.h>
 
 #include "SbtAlignGeom.h"
+#include "SbtChannelMask.h"
 #include "SbtIO.h"
 #include "SbtConfig.h"
 #include "SbtMakeClusters.h"
@@ -31,6 +32,7 @@ SbtConfig::SbtConfig() :
   _topVolName("TOP"),
   _geoManager(nullptr),
   _crystalChanneling(nullptr),
+  _clusteringThreads(1),
   _ignoreAlignment(false) {
   // initialize detectorMapArray
   for (int i = 0; i < nMaxLayerSides; i++) {
@@ -43,6 +45,7 @@ SbtConfig::SbtConfig(std::string configFileName, std::string datafile, bool igno
   _topVolName("TOP"),
   _geoManager(nullptr),
   _crystalChanneling(nullptr),
+  _clusteringThreads(1),
   _ignoreAlignment(ignoreAlign) {
   // initialize detectorMapArray
   for (int i = 0; i < nMaxLayerSides; i++) {
@@ -428,15 +431,69 @@ void SbtConfig::configureAlgorithms(const YAML::Node& config) {
       std::cout << std::endl;
       assert(0);
     }
+    // number of threads used to cluster the planes concurrently
+    _clusteringThreads = config["clustering"]["nThreads"] ? config["clustering"]["nThreads"].as<int>() : 1;
   }
 
   // instantiate the algorithm objects
-  _makeClusters = new SbtMakeClusters(_clusteringAlg, _pixelClusteringOpt);
+  _makeClusters = new SbtMakeClusters(_clusteringAlg, _pixelClusteringOpt, _clusteringThreads);
+  if (config["mask"]) {
+    // the mask is stored next to the alignment files, unless specified
+    std::string maskPath = ".";
+    if (config["mask"]["path"]) {
+      maskPath = config["mask"]["path"].as<std::string>();
+    }
+    else if (config["align"]) {
+      maskPath = config["align"]["path"].as<std::string>();
+    }
+    std::string maskName = config["mask"]["name"] ? config["mask"]["name"].as<std::string>() : "channelMask";
+    int learnEvents = config["mask"]["learnEvents"] ? config["mask"]["learnEvents"].as<int>() : 0;
+    double maxOccupancy = config["mask"]["maxOccupancy"] ? config["mask"]["maxOccupancy"].as<double>() : 0.05;
+    SbtChannelMask* channelMask = new SbtChannelMask();
+    channelMask->initialize(maskName, SbtIO::expandPath(maskPath), learnEvents, maxOccupancy);
+    // with learnEvents > 0 the mask is learned again and overwritten
+    if (learnEvents == 0 && !channelMask->readMask()) {
+      std::cout << "Configuration Error" << std::endl;
+      std::cout << "SbtConfig: no channel mask found and learnEvents not set" << std::endl;
+      assert(0);
+    }
+    _makeClusters->setChannelMask(channelMask);
+  }
+  if (config["clustering"] && config["clustering"]["dutRoiWindow"]) {
+    _makeClusters->setDutRoi(_trackDetID, config["clustering"]["dutRoiWindow"].as<double>());
+  }
   _makeHits = new SbtMakeHits();
   _makeSpacePoints = new SbtMakeSpacePoints(_spErrMethod, _trackDetErr);
+  if (config["chargeCorrelation"]) {
+    // calibrated V/U pulse-height ratio window of the double sided detectors
+    for (auto detector : config["chargeCorrelation"]["detectors"]) {
+      _makeSpacePoints->setChargeCorrelation(detector["id"].as<int>(), detector["ratio"][0].as<double>(),
+                                             detector["ratio"][1].as<double>());
+    }
+    if (config["chargeCorrelation"]["rejectGhosts"]) {
+      _makeSpacePoints->setRejectUncorrelated(config["chargeCorrelation"]["rejectGhosts"].as<bool>());
+    }
+  }
   _makeTracks = new SbtMakeTracks(config["tracking"], _trackDetID);
 }
 
+//
+// The DUT planes of the ROI mode (clustering/dutRoiWindow) are clustered
+// after the tracking, from the track intercepts: their clusters, hits and
+// space points go to the DUT lists of the event.
+//
+void SbtConfig::reconstructEvent(SbtEvent* event) {
+  _makeClusters->makeClusters(event);
+  _makeHits->makeHits(event);
+  _makeSpacePoints->makeSpacePoints(event);
+  _makeTracks->makeTracks(event);
+  if (_makeClusters->isDutRoi()) {
+    _makeClusters->makeDutClusters(event);
+    _makeHits->makeDutHits(event);
+    _makeSpacePoints->makeDutSpacePoints(event);
+  }
+}
+
 SbtDetectorType* SbtConfig::getDetectorTypeFromID(int t) {
   for (auto detType : _detectorTypes) {
     if (detType->GetID() == t) return detType;
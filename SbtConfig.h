@@ -12,6 +12,7 @@
 #include "SbtEnums.h"
 
 class SbtCrystalChanneling;
+class SbtEvent;
 class SbtEventReader;
 class TGeoManager;
 class SbtMakeClusters;
@@ -47,6 +48,9 @@ class SbtConfig {
   SbtMakeHits* getMakeHits() { return _makeHits; }
   SbtMakeSpacePoints* getMakeSpacePoints() { return _makeSpacePoints; }
   SbtMakeTracks* getMakeTracks() { return _makeTracks; }
+  // clusters, hits, space points and tracks of the event, then the DUT
+  // planes in the ROI mode
+  void reconstructEvent(SbtEvent* event);
   std::vector<int> getTrackingDetID() { return _trackDetID; }
   SbtNtupleDumper* getNtupleDumper() { return _ntupleDumper; }
   SbtEventReader* getEventReader() { return _eventReader; }
@@ -82,6 +86,7 @@ class SbtConfig {
   std::string _clusteringAlg;
   std::string _pixelClusteringOpt;  // Options  "Loose" (dx=+/-1, dy=+/-1);
                                     //          "Tight" (dx=+/-1,dy=0; dx=0,dy=+/-1)
+  int _clusteringThreads;           // threads used to cluster the planes
   std::string _patRecAlg;
   std::string _fittingAlg;
   std::string _spErrMethod;
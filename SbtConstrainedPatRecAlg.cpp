@@ -15,8 +15,11 @@
 
 ClassImp(SbtConstrainedPatRecAlg);
 
+// the direction bins are made larger for a very wide spread of directions
+static const int maxNBinsPerAxis = 64;
+
 SbtConstrainedPatRecAlg::SbtConstrainedPatRecAlg(const YAML::Node& config,std::vector<int> trackDetID)
-    : SbtPatRecAlg(config, trackDetID) {
+    : SbtPatRecAlg(config, trackDetID), _nx(0), _ny(0), _slopeXMin(0), _slopeYMin(0), _slopeBin(1) {
   if (getDebugLevel() > 0) {
     std::cout << "SbtConstrainedPatRecAlg:  DebugLevel= " << getDebugLevel() << std::endl;
   }
@@ -62,17 +65,58 @@ int SbtConstrainedPatRecAlg::_linkHits() {
   if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
 
   // create the candidate tracks with 2 SpacePoints
+  //
+  // A space point at distance d from the line through the origin and SP1
+  // is at a transverse distance of at most d * sqrt(1 + t1^2) from its
+  // crossing at the same z, t1 being the slope of SP1. That distance is
+  // |z0 - zOrigin| times the slope difference, so the space points of
+  // detector 0 in the road are within slopeBin of the direction of SP1.
+  int nSP0 = _detSpacePointList[0].size();
+  double minDz = 1e30, maxSlope2 = 0;
+  for (int i0 = 0; i0 < nSP0; i0++) {
+    minDz = std::min(minDz, fabs(_spZ[0][i0] - _origin.Z()));
+  }
   for (auto SP1 : _detSpacePointList[1]) {
-    for (auto SP0 : _detSpacePointList[0]) {
+    double dz = SP1->GetZPosition() - _origin.Z();
+    if (dz == 0) {
+      maxSlope2 = -1;
+      break;
+    }
+    double slopeX = (SP1->GetXPosition() - _origin.X()) / dz;
+    double slopeY = (SP1->GetYPosition() - _origin.Y()) / dz;
+    maxSlope2 = std::max(maxSlope2, slopeX * slopeX + slopeY * slopeY);
+  }
+  // no direction binning with space points at the origin z
+  bool useBins = minDz > 0 && maxSlope2 >= 0;
+  if (useBins) fillDirectionBins(_roadWidth * sqrt(1 + maxSlope2) / minDz);
+
+  for (auto SP1 : _detSpacePointList[1]) {
+    if (useBins) {
+      double dz = SP1->GetZPosition() - _origin.Z();
+      findInDirection((SP1->GetXPosition() - _origin.X()) / dz, (SP1->GetYPosition() - _origin.Y()) / dz,
+                      _candidates);
+    }
+    else {
+      _candidates.resize(nSP0);
+      for (int i0 = 0; i0 < nSP0; i0++) _candidates[i0] = i0;
+    }
+    int nCandidates = _candidates.size();
+    // check which Internal SPs are within the track nominal road
+    // pay attention: SP ordering matters below
+    SbtLineSegment line(_origin, SP1->point());
+    uint64_t* inRoad = roadMask(0, 0, nCandidates);
+    line.pointsInRoad(nCandidates, _candidates.data(), _spX[0].data(), _spY[0].data(), _spZ[0].data(),
+                      _roadWidth, inRoad);
+    for (int iCandidate = 0; iCandidate < nCandidates; iCandidate++) {
+      int i0 = _candidates[iCandidate];
+      SbtSpacePoint* SP0 = _detSpacePointList[0][i0];
       if (getDebugLevel() > 2) {
         std::cout << "Comparing point" << std::endl;
         SP0->point().Print();
         std::cout << "with point" << std::endl;
         SP1->point().Print();
       }
-      // check if the Internal SP is within the track nominal road
-      // pay attention: SP ordering matters below
-      if (!isInsideTrkRoad(_origin, SP1->point(), SP0->point())) {
+      if (!SbtLineSegment::inMask(inRoad, iCandidate)) {
         if (getDebugLevel() > 2) std::cout << "Not a track" << std::endl;
         continue;
       }
@@ -91,21 +135,60 @@ int SbtConstrainedPatRecAlg::_linkHits() {
   return TrkCounter;
 }
 
-bool SbtConstrainedPatRecAlg::isInsideTrkRoad(const TVector3& x0,
-                                              const TVector3& x3,
-                                              const TVector3& xInternal) {
-  bool passed = false;
+void SbtConstrainedPatRecAlg::fillDirectionBins(double slopeBin) {
+  int n = _detSpacePointList[0].size();
+  std::vector<double> slopeX(n), slopeY(n);
+  double slopeXMax = -1e30, slopeYMax = -1e30;
+  _slopeXMin = 1e30;
+  _slopeYMin = 1e30;
+  for (int i = 0; i < n; i++) {
+    double dz = _spZ[0][i] - _origin.Z();
+    slopeX[i] = (_spX[0][i] - _origin.X()) / dz;
+    slopeY[i] = (_spY[0][i] - _origin.Y()) / dz;
+    _slopeXMin = std::min(_slopeXMin, slopeX[i]);
+    _slopeYMin = std::min(_slopeYMin, slopeY[i]);
+    slopeXMax = std::max(slopeXMax, slopeX[i]);
+    slopeYMax = std::max(slopeYMax, slopeY[i]);
+  }
+  double extent = std::max(slopeXMax - _slopeXMin, slopeYMax - _slopeYMin);
+  _slopeBin = std::max(slopeBin, extent / maxNBinsPerAxis);
+  if (_slopeBin <= 0) _slopeBin = 1;
+  _nx = std::min(int((slopeXMax - _slopeXMin) / _slopeBin) + 1, maxNBinsPerAxis);
+  _ny = std::min(int((slopeYMax - _slopeYMin) / _slopeBin) + 1, maxNBinsPerAxis);
 
-  SbtLineSegment line(x0, x3);
-  if (line.distance(xInternal) < _roadWidth) {
-    passed = true;
-  } else {
-    passed = false;
+  // counting sort of the space points by cell
+  std::vector<int> cell(n);
+  _cellStart.assign(_nx * _ny + 1, 0);
+  for (int i = 0; i < n; i++) {
+    int ix = std::min(int((slopeX[i] - _slopeXMin) / _slopeBin), _nx - 1);
+    int iy = std::min(int((slopeY[i] - _slopeYMin) / _slopeBin), _ny - 1);
+    cell[i] = iy * _nx + ix;
+    _cellStart[cell[i] + 1]++;
   }
-  if (getDebugLevel() > 1) {
-    std::cout << "SbtConstrainedPatRec: Distance xInternal = "
-         << line.distance(xInternal) << std::endl;
+  for (int c = 0; c < _nx * _ny; c++) {
+    _cellStart[c + 1] += _cellStart[c];
+  }
+  std::vector<int> next(_cellStart.begin(), _cellStart.end() - 1);
+  _index.resize(n);
+  for (int i = 0; i < n; i++) {
+    _index[next[cell[i]]++] = i;
   }
+}
 
-  return passed;
+void SbtConstrainedPatRecAlg::findInDirection(double slopeX, double slopeY, std::vector<int>& candidates) const {
+  candidates.clear();
+  if (slopeX + _slopeBin < _slopeXMin || slopeX - _slopeBin > _slopeXMin + _nx * _slopeBin) return;
+  if (slopeY + _slopeBin < _slopeYMin || slopeY - _slopeBin > _slopeYMin + _ny * _slopeBin) return;
+  int ixMin = std::max(int(floor((slopeX - _slopeBin - _slopeXMin) / _slopeBin)), 0);
+  int ixMax = std::min(int(floor((slopeX + _slopeBin - _slopeXMin) / _slopeBin)), _nx - 1);
+  int iyMin = std::max(int(floor((slopeY - _slopeBin - _slopeYMin) / _slopeBin)), 0);
+  int iyMax = std::min(int(floor((slopeY + _slopeBin - _slopeYMin) / _slopeBin)), _ny - 1);
+  for (int iy = iyMin; iy <= iyMax; iy++) {
+    for (int ix = ixMin; ix <= ixMax; ix++) {
+      int c = iy * _nx + ix;
+      candidates.insert(candidates.end(), _index.begin() + _cellStart[c], _index.begin() + _cellStart[c + 1]);
+    }
+  }
+  // keep the order of the space point list
+  std::sort(candidates.begin(), candidates.end());
 }
@@ -13,6 +13,15 @@ class SbtTrack;
 class SbtSpacePoint;
 class SbtDetectorElem;
 
+//
+// Description
+//
+// two space point tracks, on the detectors 0 and 1, pointing to a fixed
+// origin. Each space point has a direction as seen from the origin: the
+// space points of detector 0 are binned by direction, and each space point
+// of detector 1 is only paired with the ones in the same or in the
+// neighbouring bins.
+
 class SbtConstrainedPatRecAlg : public SbtPatRecAlg {
  public:
   SbtConstrainedPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID);
@@ -20,8 +29,20 @@ class SbtConstrainedPatRecAlg : public SbtPatRecAlg {
 
  protected:
   TVector3 _origin;
-  bool isInsideTrkRoad(const TVector3& x0, const TVector3& x3, const TVector3& xInternal);
   int _linkHits();
+  // bin the space points of detector 0 by direction from the origin, in
+  // square cells of slopeBin
+  void fillDirectionBins(double slopeBin);
+  // indices, in increasing order, of the space points of detector 0 in the
+  // cells within slopeBin of the direction (slopeX, slopeY)
+  void findInDirection(double slopeX, double slopeY, std::vector<int>& candidates) const;
+
+  // direction bins of the detector 0 space points
+  int _nx, _ny;  //!
+  double _slopeXMin, _slopeYMin, _slopeBin;  //!
+  std::vector<int> _cellStart;  //! _index[_cellStart[c].._cellStart[c+1]] in cell c
+  std::vector<int> _index;  //!
+  std::vector<int> _candidates;  //!
 
   ClassDef(SbtConstrainedPatRecAlg, 1);
 };
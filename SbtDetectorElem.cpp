@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include <TGeoManager.h>
+#include <TGeoMaterial.h>
 #include <TGeoMatrix.h>
 #include <TGeoVolume.h>
 #include <TMath.h>
@@ -86,6 +87,7 @@ SbtDetectorElem::SbtDetectorElem(TGeoManager *geom,
   }
 
   top->AddNode(_detVolume, detElemId, _rt);
+  UpdateTransforms();
 
   if (_DebugLevel) {
     std::cout << "Exiting SbtDetectorElem 'ctor " << detVolName << std::endl;
@@ -103,8 +105,9 @@ void SbtDetectorElem::MasterToLocal(double *master, double *local) const {
 
 // see header file for discussion of local prime coords
 void SbtDetectorElem::LocalToLocalPrime(double *local, double *localprime) const {
-  double c = cos(_detType->GetStripAngle());
-  double s = sin(_detType->GetStripAngle());
+  CheckTransforms();
+  double c = _cosStripAngle;
+  double s = _sinStripAngle;
 
   localprime[0] = c * local[0] - s * local[1];
   localprime[1] = s * local[0] + c * local[1];
@@ -112,16 +115,19 @@ void SbtDetectorElem::LocalToLocalPrime(double *local, double *localprime) const
 }
 
 void SbtDetectorElem::LocalPrimeToMaster(double *localprime, double *master) const {
-  _geoManager->GetTopVolume()->GetNode(_detElemId)->LocalToMaster(localprime, master);
+  CheckTransforms();
+  ApplyTransform(_localPrimeToMasterT, localprime, master);
 }
 
 void SbtDetectorElem::MasterToLocalPrime(double *master, double *localprime) const {
-  _geoManager->GetTopVolume()->GetNode(_detElemId)->MasterToLocal(master, localprime);
+  CheckTransforms();
+  ApplyTransform(_masterToLocalPrimeT, master, localprime);
 }
 
 void SbtDetectorElem::LocalPrimeToLocal(double *localprime, double *local) const {
-  double c = cos(_detType->GetStripAngle());
-  double s = sin(_detType->GetStripAngle());
+  CheckTransforms();
+  double c = _cosStripAngle;
+  double s = _sinStripAngle;
 
   local[0] = c * localprime[0] + s * localprime[1];
   local[1] = -s * localprime[0] + c * localprime[1];
@@ -133,15 +139,96 @@ void SbtDetectorElem::MasterToLocalVect(double *master, double *local) const {
 }
 
 void SbtDetectorElem::MasterToLocalPrimeVect(double *master, double *localprime) const {
-  _geoManager->GetTopVolume()->GetNode(_detElemId)->MasterToLocalVect(master, localprime);
+  CheckTransforms();
+  ApplyRotation(_masterToLocalPrimeT, master, localprime);
 }
 
 void SbtDetectorElem::LocalToMasterVect(double *local, double *master) const {
-  MasterToLocalPrimeVect(local, master);
+  LocalPrimeToMasterVect(local, master);
 }
 
 void SbtDetectorElem::LocalPrimeToMasterVect(double *localprime, double *master) const {
-  _geoManager->GetTopVolume()->GetNode(_detElemId)->LocalToMasterVect(master, localprime);
+  CheckTransforms();
+  ApplyRotation(_localPrimeToMasterT, localprime, master);
+}
+
+void SbtDetectorElem::UpdateTransforms() const {
+  // the node of this element in the top volume is placed with _rt
+  const double *rot = _rt->GetRotationMatrix();
+  const double *tr = _rt->GetTranslation();
+
+  double angle = (_detType->GetType() == "pixel") ? 0 : _detType->GetStripAngle();
+  _cosStripAngle = cos(angle);
+  _sinStripAngle = sin(angle);
+  // local to local prime rotation
+  const double L[9] = {_cosStripAngle, -_sinStripAngle, 0,
+                       _sinStripAngle,  _cosStripAngle, 0,
+                       0, 0, 1};
+
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      // local prime -> master: R, master -> local prime: R^T
+      _localPrimeToMasterT[4 * i + j] = rot[3 * i + j];
+      _masterToLocalPrimeT[4 * i + j] = rot[3 * j + i];
+      // local -> master: R * L
+      double rl = 0;
+      for (int k = 0; k < 3; k++) rl += rot[3 * i + k] * L[3 * k + j];
+      _localToMasterT[4 * i + j] = rl;
+      _masterToLocalT[4 * j + i] = rl;
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    _localPrimeToMasterT[4 * i + 3] = tr[i];
+    _localToMasterT[4 * i + 3] = tr[i];
+    double tPrime = 0, tLocal = 0;
+    for (int j = 0; j < 3; j++) {
+      tPrime -= _masterToLocalPrimeT[4 * i + j] * tr[j];
+      tLocal -= _masterToLocalT[4 * i + j] * tr[j];
+    }
+    _masterToLocalPrimeT[4 * i + 3] = tPrime;
+    _masterToLocalT[4 * i + 3] = tLocal;
+  }
+  _transformsDirty = false;
+}
+
+// batch versions
+void SbtDetectorElem::ApplyTransform(const double *t, int n, const double *x, const double *y, const double *z,
+                                     double *outX, double *outY, double *outZ) {
+  // the matrix elements are loaded once, the loop over the points is
+  // left to the compiler to vectorize
+  const double t0 = t[0], t1 = t[1], t2 = t[2], t3 = t[3];
+  const double t4 = t[4], t5 = t[5], t6 = t[6], t7 = t[7];
+  const double t8 = t[8], t9 = t[9], t10 = t[10], t11 = t[11];
+  for (int i = 0; i < n; i++) {
+    double xi = x[i], yi = y[i], zi = z[i];
+    outX[i] = t0 * xi + t1 * yi + t2 * zi + t3;
+    outY[i] = t4 * xi + t5 * yi + t6 * zi + t7;
+    outZ[i] = t8 * xi + t9 * yi + t10 * zi + t11;
+  }
+}
+
+void SbtDetectorElem::LocalToMaster(int n, const double *lx, const double *ly, const double *lz,
+                                    double *mx, double *my, double *mz) const {
+  CheckTransforms();
+  ApplyTransform(LocalToMasterTransform(), n, lx, ly, lz, mx, my, mz);
+}
+
+void SbtDetectorElem::MasterToLocal(int n, const double *mx, const double *my, const double *mz,
+                                    double *lx, double *ly, double *lz) const {
+  CheckTransforms();
+  ApplyTransform(MasterToLocalTransform(), n, mx, my, mz, lx, ly, lz);
+}
+
+void SbtDetectorElem::LocalPrimeToMaster(int n, const double *lx, const double *ly, const double *lz,
+                                         double *mx, double *my, double *mz) const {
+  CheckTransforms();
+  ApplyTransform(_localPrimeToMasterT, n, lx, ly, lz, mx, my, mz);
+}
+
+void SbtDetectorElem::MasterToLocalPrime(int n, const double *mx, const double *my, const double *mz,
+                                         double *lx, double *ly, double *lz) const {
+  CheckTransforms();
+  ApplyTransform(_masterToLocalPrimeT, n, mx, my, mz, lx, ly, lz);
 }
 
 // the following versions use TVector3 instead of double*
@@ -280,6 +367,10 @@ int SbtDetectorElem::Channel(double pos, SbtEnums::view side) const {
   return _detType->Channel(orientation * pos, side);
 }
 
+double SbtDetectorElem::GetRadLen() const {
+  return _detVolume->GetMaterial()->GetRadLen();
+}
+
 bool SbtDetectorElem::InActiveArea(TVector3 point) const {
   // is the point with the detector active area. By convention, the
   // point is in local coordinates
@@ -288,3 +379,16 @@ bool SbtDetectorElem::InActiveArea(TVector3 point) const {
           (point.Y() > _detType->GetVActMin()) &
           (point.Y() < _detType->GetVActMax()));
 }
+
+int SbtDetectorElem::InActiveArea(int n, const double *u, const double *v, unsigned char *ok) const {
+  double uMin = _detType->GetUActMin();
+  double uMax = _detType->GetUActMax();
+  double vMin = _detType->GetVActMin();
+  double vMax = _detType->GetVActMax();
+  int nOk = 0;
+  for (int i = 0; i < n; i++) {
+    ok[i] = (u[i] > uMin) & (u[i] < uMax) & (v[i] > vMin) & (v[i] < vMax);
+    nOk += ok[i];
+  }
+  return nOk;
+}
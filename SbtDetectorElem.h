@@ -52,12 +52,23 @@ class SbtDetectorElem {
   void MasterToLocalPrime(TVector3 master, TVector3& localprime) const;  // 4 : TVector3
   void MasterToLocalPrimeVect(TVector3 master, TVector3& localprime) const;  // 8 : TVector3
 
+  // batch versions for n points stored as separate x, y, z arrays
+  void LocalToMaster(int n, const double* lx, const double* ly, const double* lz,
+                     double* mx, double* my, double* mz) const;
+  void MasterToLocal(int n, const double* mx, const double* my, const double* mz,
+                     double* lx, double* ly, double* lz) const;
+  void LocalPrimeToMaster(int n, const double* lx, const double* ly, const double* lz,
+                          double* mx, double* my, double* mz) const;
+  void MasterToLocalPrime(int n, const double* mx, const double* my, const double* mz,
+                          double* lx, double* ly, double* lz) const;
+
   SbtDetectorType* GetDetectorType() const { return _detType; }
   int GetID() const { return _detElemId; }
   int GetTrackingID() const { return _detTrackId; }
   double GetXPos() const { return _xPos; }
   double GetYPos() const { return _yPos; };
   double GetZPos() const { return _zPos; };
+  double GetRadLen() const;  // radiation length of the detector material
   void AddLayerSide(int i) { _layerSides.push_back(i); }
   int GetLayerSide(SbtEnums::view LayerView) const;
   const TGeoManager* GetGeoManager() const { return _geoManager; };
@@ -65,11 +76,19 @@ class SbtDetectorElem {
   const TGeoTranslation* GetTranslation() const { return _tr; };
   const TGeoCombiTrans* GetCombiTrans() const { return _rt; };
 
-  TGeoRotation* GetRotation() { return _rot; };
-  TGeoTranslation* GetTranslation() { return _tr; };
-  TGeoCombiTrans* GetCombiTrans() { return _rt; };
+  // non-const access may change the placement (e.g. alignment), hence
+  // the cached transforms are refreshed before their next use
+  TGeoRotation* GetRotation() { _transformsDirty = true; return _rot; };
+  TGeoTranslation* GetTranslation() { _transformsDirty = true; return _tr; };
+  TGeoCombiTrans* GetCombiTrans() { _transformsDirty = true; return _rt; };
+
+  // recompute the cached transforms from the current placement
+  void UpdateTransforms() const;
 
   virtual bool InActiveArea(TVector3 point) const;
+  // batch version for n local points (u[i], v[i]) in the wafer plane:
+  // sets ok[i] and returns the number of points in the active area
+  virtual int InActiveArea(int n, const double* u, const double* v, unsigned char* ok) const;
 
   // pure virtual method to transform the set/strip information
   // in a single channel information
@@ -109,6 +128,39 @@ class SbtDetectorElem {
   SbtDetectorType* _detType;  // make the data available to the inheriting
                               // classes Strip, Striplets, Pixel
 
+  // cached affine transforms, stored as row-major 3x4 matrices [R|t]
+  // so that a point transforms as out = R * in + t
+  mutable double _localPrimeToMasterT[12];  //!
+  mutable double _masterToLocalPrimeT[12];  //!
+  // the same including the local to local prime rotation (striplets)
+  mutable double _localToMasterT[12];  //!
+  mutable double _masterToLocalT[12];  //!
+  mutable double _cosStripAngle;  //!
+  mutable double _sinStripAngle;  //!
+  mutable bool _transformsDirty;  //!
+
+  // transforms used by LocalToMaster/MasterToLocal: local and local prime
+  // coincide except for striplets
+  virtual const double* LocalToMasterTransform() const { return _localPrimeToMasterT; }
+  virtual const double* MasterToLocalTransform() const { return _masterToLocalPrimeT; }
+
+  static void ApplyTransform(const double* t, int n, const double* x, const double* y, const double* z,
+                             double* outX, double* outY, double* outZ);
+
+  void CheckTransforms() const {
+    if (_transformsDirty) UpdateTransforms();
+  }
+  static void ApplyTransform(const double* t, const double* in, double* out) {
+    out[0] = t[0] * in[0] + t[1] * in[1] + t[2] * in[2] + t[3];
+    out[1] = t[4] * in[0] + t[5] * in[1] + t[6] * in[2] + t[7];
+    out[2] = t[8] * in[0] + t[9] * in[1] + t[10] * in[2] + t[11];
+  }
+  static void ApplyRotation(const double* t, const double* in, double* out) {
+    out[0] = t[0] * in[0] + t[1] * in[1] + t[2] * in[2];
+    out[1] = t[4] * in[0] + t[5] * in[1] + t[6] * in[2];
+    out[2] = t[8] * in[0] + t[9] * in[1] + t[10] * in[2];
+  }
+
   ClassDef(SbtDetectorElem, 0);  // Implementation of DetectorElem
 };
 
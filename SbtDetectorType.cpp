@@ -71,6 +71,43 @@ SbtDetectorType::SbtDetectorType(int typeId, std::string typeDet, double xHalfDi
   assert(_uPrimeActMax != 0);
   assert(_vPrimeActMin != 0);
   assert(_vPrimeActMax != 0);
+
+  BuildGeometryTables();
+}
+
+void SbtDetectorType::BuildGeometryTables() {
+  if (_typeDet == "strip")
+    _intType = 0;
+  else if (_typeDet == "striplet")
+    _intType = 1;
+  else if (_typeDet == "pixel")
+    _intType = 2;
+  else if (_typeDet == "singleside")
+    _intType = 3;
+  else
+    _intType = -1;
+
+  _cosStripAngle = cos(_uAngle);
+  _sinStripAngle = sin(_uAngle);
+
+  int nStrips[2] = {_uNstrips, _vNstrips};
+  double pitch[2] = {_uPitch, _vPitch};
+  for (int side = SbtEnums::U; side <= SbtEnums::V; side++) {
+    _channelPosition[side].resize(nStrips[side]);
+    for (int ch = 0; ch < nStrips[side]; ch++) {
+      _channelPosition[side][ch] = pitch[side] * (ch - double(nStrips[side] - 1) / 2.0);
+    }
+
+    _endPoints[side].clear();
+    _endPointClip[side].clear();
+    if (_intType == 2) continue;  // pixels have no strips
+    _endPoints[side].resize(4 * nStrips[side]);
+    _endPointClip[side].resize(nStrips[side]);
+    for (int ch = 0; ch < nStrips[side]; ch++) {
+      _endPointClip[side][ch] = ComputeEndPoints(SbtEnums::view(side), _channelPosition[side][ch],
+                                                 &_endPoints[side][4 * ch]);
+    }
+  }
 }
 
 void SbtDetectorType::setSimulationParameters(SbtEnums::pdf elossDistr, double elossMPV, double elossSigma, double adcGain, int adcSaturation, int thU, int thV, bool floatStrips, double chargeSpread, double artificialRes) {
@@ -112,20 +149,11 @@ std::string SbtDetectorType::GetType() {
 }
 
 int SbtDetectorType::GetIntType() {
-  int intType(-1);
-  if (_typeDet == "strip")
-    intType = 0;
-  else if (_typeDet == "striplet")
-    intType = 1;
-  else if (_typeDet == "pixel")
-    intType = 2;
-  else if (_typeDet == "singleside")
-    intType = 3;
-  else {
+  if (_intType < 0) {
     std::cout << "SbtDetectorType::GetIntType(): _typeDet not valid " << std::endl;
     assert(0);
   }
-  return intType;
+  return _intType;
 }
 
 // This function gives the local coordinate given an electronics channel
@@ -142,6 +170,7 @@ double SbtDetectorType::Position(int channel, SbtEnums::view side) {
 
 double SbtDetectorType::uPosition(int channel) {
   // channel goes from 0 to (nstrip-1)
+  if (channel >= 0 && channel < _uNstrips) return _channelPosition[SbtEnums::U][channel];
 
   double pos = _uPitch * (channel - double(_uNstrips - 1) / 2.0);
 
@@ -150,6 +179,8 @@ double SbtDetectorType::uPosition(int channel) {
 
 double SbtDetectorType::vPosition(int channel) {
   // channel goes from 0 to (nstrip-1)
+  if (channel >= 0 && channel < _vNstrips) return _channelPosition[SbtEnums::V][channel];
+
   double pos = _vPitch * (channel - double(_vNstrips - 1) / 2.0);
 
   return pos;
@@ -167,34 +198,51 @@ int SbtDetectorType::Channel(double pos, SbtEnums::view side) {
   return int(c + .5);
 }
 
+// The end points are interpolated between the tabulated values of the two
+// neighbouring channels. This is exact as long as the same boundary clips
+// the strip at both channels, which is always the case for strips and
+// almost always for striplets; otherwise they are computed.
 void SbtDetectorType::GetEndPoints(SbtEnums::view side, double pos,
                                    TVector3& p1, TVector3& p2) {
+  assert("pixel" != _typeDet);
   p1[2] = p2[2] = 0;  // w=0 always (in wafer plane)
 
-  if ("strip" == _typeDet) {
-    if (SbtEnums::U == side) {  // u strips on normal strip detector
-
-      p1[0] = pos;
-      p2[0] = p1[0];
-
-      p1[1] = GetVActMin();
-      p2[1] = GetVActMax();
+  double ends[4];
+  const std::vector<double>& table = _endPoints[side];
+  const std::vector<int>& clip = _endPointClip[side];
+  int nStrips = clip.size();
+  double pitch = SbtEnums::U == side ? _uPitch : _vPitch;
+  double c = pos / pitch + double(nStrips - 1) / 2.0;
+  int ch = int(floor(c));
+  if (ch >= 0 && ch + 1 < nStrips && clip[ch] == clip[ch + 1]) {
+    double f = c - ch;
+    const double* a = &table[4 * ch];
+    const double* b = a + 4;
+    for (int i = 0; i < 4; i++) {
+      ends[i] = a[i] + f * (b[i] - a[i]);
+    }
+  }
+  else {
+    ComputeEndPoints(side, pos, ends);
+  }
 
-    } else {  // v strips
-      p1[1] = pos;
-      p2[1] = p1[1];
+  p1[0] = ends[0];
+  p1[1] = ends[1];
+  p2[0] = ends[2];
+  p2[1] = ends[3];
+}
 
-      p1[0] = GetUActMin();
-      p2[0] = GetUActMax();
-    }
-  } else if ("striplet" == _typeDet) {
+int SbtDetectorType::ComputeEndPoints(SbtEnums::view side, double pos,
+                                      double* ends) const {
+  int clip = 0;
+  if (_intType == 1) {
     // with striplet calculating the end points is more complicated
     // assume strip strip terminates either at vmax or v' max
     // or vmin or v' min
     //
 
-    double c = cos(GetStripAngle());
-    double s = sin(GetStripAngle());
+    double c = _cosStripAngle;
+    double s = _sinStripAngle;
 
     if (SbtEnums::U == side) {
       //
@@ -202,27 +250,23 @@ void SbtDetectorType::GetEndPoints(SbtEnums::view side, double pos,
       //
 
       double u = pos;
-      double vmax = GetVActMax();
 
       // value of v, when vprime = vprime max
-      double vcalc = (GetVPrimeActMax() - s * u) / c;
-      double v = TMath::Min(vmax, vcalc);
+      double vcalc = (_vPrimeActMax - s * u) / c;
+      if (vcalc < _vActMax) clip |= 1;
 
-      p1[0] = u;
-      p1[1] = v;
+      ends[0] = u;
+      ends[1] = TMath::Min(_vActMax, vcalc);
 
       //
       // p2 - small v
       //
 
-      double vmin = GetVActMin();
-      vcalc = (GetVPrimeActMin() - s * u) / c;
-
-      v = TMath::Max(vmin, vcalc);
-
-      p2[0] = u;
-      p2[1] = v;
+      vcalc = (_vPrimeActMin - s * u) / c;
+      if (vcalc > _vActMin) clip |= 2;
 
+      ends[2] = u;
+      ends[3] = TMath::Max(_vActMin, vcalc);
     }
 
     else {  // V side
@@ -231,34 +275,32 @@ void SbtDetectorType::GetEndPoints(SbtEnums::view side, double pos,
       //
 
       double v = pos;
-      double umax = GetUActMax();
-      double ucalc = (GetVPrimeActMax() - c * v) / s;
-
-      double u = TMath::Min(umax, ucalc);
+      double ucalc = (_vPrimeActMax - c * v) / s;
+      if (ucalc < _uActMax) clip |= 1;
 
-      p1[0] = u;
-      p1[1] = v;
+      ends[0] = TMath::Min(_uActMax, ucalc);
+      ends[1] = v;
 
       //
       // p2 - small u
       //
 
-      double umin = GetUActMin();
-      ucalc = (GetVPrimeActMin() - c * v) / s;
+      ucalc = (_vPrimeActMin - c * v) / s;
+      if (ucalc > _uActMin) clip |= 2;
 
-      u = TMath::Max(umin, ucalc);
-
-      p2[0] = u;
-      p2[1] = v;
+      ends[2] = TMath::Max(_uActMin, ucalc);
+      ends[3] = v;
     }
-  } else if ("singleside" == _typeDet) {
-    p1[0] = pos;
-    p2[0] = p1[0];
-
-    p1[1] = GetVActMin();
-    p2[1] = GetVActMax();
-
-  } else {
-    assert("pixel" != _typeDet);
+  } else if (_intType == 0 && SbtEnums::V == side) {  // v strips
+    ends[0] = _uActMin;
+    ends[1] = pos;
+    ends[2] = _uActMax;
+    ends[3] = pos;
+  } else {  // u strips on normal strip detector and single side
+    ends[0] = pos;
+    ends[1] = _vActMin;
+    ends[2] = pos;
+    ends[3] = _vActMax;
   }
+  return clip;
 }
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <string>
+#include <vector>
 
 #include <Rtypes.h>
 
@@ -97,6 +98,13 @@ class SbtDetectorType {
   double getArtificialSpRes() const { return _artificalSpRes; }
 
  protected:
+  // fill the channel position and strip end point tables
+  void BuildGeometryTables();
+  // exact strip end points (u1, v1, u2, v2) in the wafer plane; returns
+  // for striplets which end is clipped by the prime active area (bit 0
+  // for p1, bit 1 for p2), 0 otherwise
+  int ComputeEndPoints(SbtEnums::view side, double pos, double* ends) const;
+
   int _DebugLevel;
   int _typeId;
   std::string _typeDet;
@@ -115,6 +123,13 @@ class SbtDetectorType {
   double _uOffset, _vOffset;
   int _uNstrips, _vNstrips;
 
+  // geometry lookup tables per side, indexed by channel
+  int _intType;                           //!
+  double _cosStripAngle, _sinStripAngle;  //!
+  std::vector<double> _channelPosition[2];  //!
+  std::vector<double> _endPoints[2];        //! u1, v1, u2, v2 per channel
+  std::vector<int> _endPointClip[2];        //! see ComputeEndPoints
+
   // For simulation
   SbtEnums::pdf _elossDistr;
   double _elossMPV;
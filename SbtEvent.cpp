@@ -44,6 +44,11 @@ void SbtEvent::reset() {
 
   _theSpacePoints.clear();
 
+  _theDutStripClusters.clear();
+  _theDutPxlClusters.clear();
+  _theDutHits.clear();
+  _theDutSpacePoints.clear();
+
   _theTracks.clear();
   _simulatedTracks.clear();
   _idealTracks.clear();
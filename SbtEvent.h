@@ -66,6 +66,12 @@ class SbtEvent {
   std::vector<SbtTrack>& GetIdealTrackList() { return _idealTracks; }
   std::vector<SbtTrack>& GetMCTrackList() { return _simulatedTracks; }
 
+  // DUT objects made from the track ROIs, after the tracking
+  std::vector<SbtCluster>& GetDutStripClusterList() { return _theDutStripClusters; }
+  std::vector<SbtCluster>& GetDutPxlClusterList() { return _theDutPxlClusters; }
+  std::vector<SbtHit>& GetDutHitList() { return _theDutHits; }
+  std::vector<SbtSpacePoint>& GetDutSpacePointList() { return _theDutSpacePoints; }
+
   const std::vector<SbtDigi>& GetStripDigiList() const { return _theStripDigis; }
   const std::vector<SbtDigi>& GetPxlDigiList() const { return _thePxlDigis; }
 
@@ -78,6 +84,11 @@ class SbtEvent {
   const std::vector<SbtTrack>& GetIdealTrackList() const { return _idealTracks; }
   const std::vector<SbtTrack>& GetMCTrackList() const { return _simulatedTracks; }
 
+  const std::vector<SbtCluster>& GetDutStripClusterList() const { return _theDutStripClusters; }
+  const std::vector<SbtCluster>& GetDutPxlClusterList() const { return _theDutPxlClusters; }
+  const std::vector<SbtHit>& GetDutHitList() const { return _theDutHits; }
+  const std::vector<SbtSpacePoint>& GetDutSpacePointList() const { return _theDutSpacePoints; }
+
   // method to get the trigger mask
   SbtTriggerInfo* GetTriggerInfo() const { return _triggerInfo; }
 
@@ -196,6 +207,14 @@ class SbtEvent {
   std::vector<SbtTrack> _simulatedTracks;  // MC simulated tracks
   std::vector<SbtTrack> _idealTracks;  // MC ideal (no material effects) tracks
 
+  // DUT clusters, hits and space points of the ROI mode: they are made
+  // when the lists above are already pointed to by hits, space points and
+  // tracks, so they are kept apart instead of being appended
+  std::vector<SbtCluster> _theDutStripClusters;
+  std::vector<SbtCluster> _theDutPxlClusters;
+  std::vector<SbtHit> _theDutHits;
+  std::vector<SbtSpacePoint> _theDutSpacePoints;
+
   bool _dataIsGood;
 
   // the trigger information
@@ -259,7 +278,7 @@ class SbtEvent {
   bool _IsTrackable;
   unsigned int _TDCTime;
 
-  ClassDef(SbtEvent, 1);
+  ClassDef(SbtEvent, 2);
 };
 
 #endif
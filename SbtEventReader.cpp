@@ -1,3 +1,6 @@
+#include <cassert>
+#include <iostream>
+
 #include <yaml-cpp/yaml.h>
 
 // including package classes
@@ -8,16 +11,19 @@
 ClassImp(SbtEventReader);
 
 SbtEventReader::SbtEventReader()
-    : _debugLevel(0), _configurator(nullptr), _eventRawReader(nullptr), _name() {
+    : _debugLevel(0), _configurator(nullptr), _eventRawReader(nullptr), _name(),
+      _useBCOWindow(false), _bcoWindowMin(0), _bcoWindowMax(0), _bcoBits(8), _bcoMask(0xff) {
 }
 
 SbtEventReader::SbtEventReader(std::string fileName)
-    : _debugLevel(0), _configurator(nullptr), _eventRawReader(nullptr), _name() {
+    : _debugLevel(0), _configurator(nullptr), _eventRawReader(nullptr), _name(),
+      _useBCOWindow(false), _bcoWindowMin(0), _bcoWindowMax(0), _bcoBits(8), _bcoMask(0xff) {
   loadConfiguration(fileName);
 }
 
 SbtEventReader::SbtEventReader(const YAML::Node& conf)
-    : _debugLevel(0), _configurator(nullptr), _eventRawReader(nullptr), _name() {
+    : _debugLevel(0), _configurator(nullptr), _eventRawReader(nullptr), _name(),
+      _useBCOWindow(false), _bcoWindowMin(0), _bcoWindowMax(0), _bcoBits(8), _bcoMask(0xff) {
   loadConfiguration(conf);
 }
 
@@ -32,6 +38,29 @@ void SbtEventReader::loadConfiguration(const YAML::Node& conf) {
   _eventRawReader = SbtEventRawReader::createRawReader(eventRawReaderName);
   if (_configurator) _eventRawReader->setConfigurator(_configurator);
   if (_eventRawReader) _eventRawReader->loadConfiguration(conf);
+  if (conf["bcoBits"]) setBCOBits(conf["bcoBits"].as<int>());
+  if (conf["bcoWindow"]) {
+    std::vector<long> window = conf["bcoWindow"].as<std::vector<long>>();
+    assert(window.size() == 2);
+    setBCOWindow(window[0], window[1]);
+  }
+}
+
+void SbtEventReader::setBCOBits(int bits) {
+  assert(bits > 0 && bits <= 64);
+  _bcoBits = bits;
+  _bcoMask = bits == 64 ? ~0UL : (1UL << bits) - 1;
+}
+
+void SbtEventReader::setBCOWindow(long min, long max) {
+  assert(min <= max);
+  // the window must be shorter than a turn of the front-end BCO counter
+  assert((unsigned long)(max - min) < _bcoMask);
+  _useBCOWindow = true;
+  _bcoWindowMin = min;
+  _bcoWindowMax = max;
+  std::cout << "SbtEventReader: BCO window [" << _bcoWindowMin << ", "
+            << _bcoWindowMax << "] around the trigger BCO" << std::endl;
 }
 
 SbtEvent* SbtEventReader::readEvent() {
@@ -42,6 +71,7 @@ SbtEvent* SbtEventReader::readEvent() {
     return nullptr;
   }
   SbtEvent* event = new SbtEvent(_eventRawReader->getEvent());
+  if (_useBCOWindow) filterBCO(*event);
   return event;
 }
 
@@ -53,9 +83,38 @@ bool SbtEventReader::readEvent(SbtEvent& evt) {
     return false;
   }
   evt = _eventRawReader->getEvent();
+  if (_useBCOWindow) filterBCO(evt);
   return true;
 }
 
+void SbtEventReader::filterBCO(SbtEvent& evt) {
+  unsigned long triggerBCO = evt.GetBCOCounter();
+  int nStrip = compactDigis(evt.GetStripDigiList(), triggerBCO);
+  int nPxl = compactDigis(evt.GetPxlDigiList(), triggerBCO);
+  if (_debugLevel > 0) {
+    std::cout << "SbtEventReader::filterBCO: removed " << nStrip << " strip and "
+              << nPxl << " pixel digis out of time" << std::endl;
+  }
+}
+
+int SbtEventReader::compactDigis(std::vector<SbtDigi>& digis, unsigned long triggerBCO) const {
+  // both edges of the window are tested with a single unsigned comparison,
+  // and every digi is copied to the write position, which only advances
+  // for digis in time: no data-dependent branch in the loop. The front-end
+  // BCO counters are narrower than the trigger counter and wrap around, so
+  // the distance from the window is taken modulo the front-end BCO width
+  unsigned long low = triggerBCO + _bcoWindowMin;
+  unsigned long width = _bcoWindowMax - _bcoWindowMin;
+  unsigned int nDigi = digis.size();
+  unsigned int nKept = 0;
+  for (unsigned int iDigi = 0; iDigi < nDigi; iDigi++) {
+    digis[nKept] = digis[iDigi];
+    nKept += ((digis[iDigi].GetBCO() - low) & _bcoMask) <= width;
+  }
+  digis.erase(digis.begin() + nKept, digis.end());
+  return nDigi - nKept;
+}
+
 
 void SbtEventReader::reset() {
   _eventRawReader->reset();
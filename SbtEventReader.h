@@ -3,10 +3,12 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "SbtEventRawReader.h"
 
 class SbtConfig;
+class SbtDigi;
 class SbtEvent;
 
 class SbtEventReader {
@@ -35,13 +37,31 @@ class SbtEventReader {
 
   void reset();
 
+  // keep only the digis with trigger BCO + min <= BCO <= trigger BCO + max
+  void setBCOWindow(long min, long max);
+  // width in bits of the front-end BCO counters, the BCOs are compared
+  // modulo this width
+  void setBCOBits(int bits);
+  int getBCOBits() const { return _bcoBits; }
+  bool hasBCOWindow() const { return _useBCOWindow; }
+
  protected:
+  // timing filter applied right after decoding
+  void filterBCO(SbtEvent& evt);
+  int compactDigis(std::vector<SbtDigi>& digis, unsigned long triggerBCO) const;
+
   int _debugLevel;
   SbtConfig* _configurator;  // the telescope configurator
   SbtEventRawReader* _eventRawReader;
   std::string _name;
 
-  ClassDef(SbtEventReader, 1);
+  bool _useBCOWindow;
+  long _bcoWindowMin;
+  long _bcoWindowMax;
+  int _bcoBits;
+  unsigned long _bcoMask;
+
+  ClassDef(SbtEventReader, 2);
 };
 
 #endif
@@ -0,0 +1,132 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+#include <TVector3.h>
+
+#include "SbtDetectorElem.h"
+#include "SbtEvent.h"
+#include "SbtFixedPatRecAlg.h"
+#include "SbtSpacePoint.h"
+#include "SbtTrack.h"
+
+templateClassImp(SbtFixedPatRecAlg);
+
+template <int NPlanes>
+SbtFixedPatRecAlg<NPlanes>::SbtFixedPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID)
+    : SbtPatRecAlg(config, trackDetID), _trkCounter(0), _nRoadCandidates(0) {
+  if (getDebugLevel() > 0) {
+    std::cout << "SbtFixedPatRecAlg<" << NPlanes << ">: DebugLevel= " << getDebugLevel() << std::endl;
+  }
+  assert(_nTrackDet == NPlanes);
+  _algName = "Fixed";
+}
+
+template <int NPlanes>
+int SbtFixedPatRecAlg<NPlanes>::_linkHits() {
+  // reset all the lists
+  for (int i = 0; i < maxNTelescopeDetector; i++) {
+    _detSpacePointList[i].clear();
+  }
+  // _trackDetID contains the telescope DetectorElemID ordered according to z
+  if (getDebugLevel()) {
+    std::cout << "SbtFixedPatRecAlg::linkHits " << std::endl;
+  }
+
+  _trkCounter = 0;
+  _nRoadCandidates = 0;
+  // tracks with space points on all Telescope Det are selected
+  if (_currentEvent->GetSpacePointList().size() < NPlanes) {
+    if (getDebugLevel()) {
+      std::cout << "WARNING: #" << _currentEvent->GetSpacePointList().size() << " Spacepoints found."
+           << "Skip the event" << std::endl;
+    }
+    return 0;
+  }
+
+  if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
+
+  for (int k = 1; k < NPlanes - 1; k++) {
+    _grid[k].fill(_detSpacePointList[_trackDetID[k]], _roadWidth);
+  }
+  _roadCandidates.resize(_nThreads * NPlanes);
+
+  // each pair of outer space points is a seed: the seeds are searched in
+  // parallel and the tracks are built in seed order
+  // (only the pairs within the beam slope window, if there is one)
+  const int last = NPlanes - 1;
+  int front = _trackDetID[0], back = _trackDetID[last];
+  CandidateList candidates;
+  _nRoadCandidates = runSeeds(makeSeeds(), [&](int seed, int worker, CandidateList& found) {
+    int indices[NPlanes];
+    getSeed(seed, indices[0], indices[last]);
+
+    seedRoad road;
+    road._front.SetXYZ(_spX[front][indices[0]], _spY[front][indices[0]], _spZ[front][indices[0]]);
+    road._back.SetXYZ(_spX[back][indices[last]], _spY[back][indices[last]], _spZ[back][indices[last]]);
+    road._line = SbtLineSegment(road._front, road._back);
+
+    // the road is fixed by the seed: the space points of all the inner
+    // planes in the road are found once, before the loops
+    int nRoadCandidates = 0;
+    if (!findRoadCandidates(road, worker, nRoadCandidates)) return nRoadCandidates;
+    LoopOnPlane(std::integral_constant<int, 1>(), indices, worker, found);
+    return nRoadCandidates;
+  }, candidates);
+
+  //  start to build the tracks using SpacePoints
+  for (auto& SPList : candidates) {
+    _currentEvent->AddTrack(SbtTrack(SPList));
+    _trkCounter++;
+  }
+
+  if (getDebugLevel() > 1) {
+    std::cout << "SbtFixedPatRecAlg: _trkCounter = " << _trkCounter << std::endl;
+    std::cout << "SbtFixedPatRecAlg: road candidates = " << _nRoadCandidates << std::endl;
+  }
+  return _trkCounter;
+}
+
+template <int NPlanes>
+bool SbtFixedPatRecAlg<NPlanes>::findRoadCandidates(const seedRoad& road, int worker, int& nRoadCandidates) {
+  for (int k = 1; k < NPlanes - 1; k++) {
+    int detID = _trackDetID[k];
+    std::vector<int>& candidates = _roadCandidates[worker * NPlanes + k];
+    _grid[k].findInRoad(road._front, road._back, getRoadWidth(k), candidates);
+    int nCandidates = candidates.size();
+    nRoadCandidates += nCandidates;
+    // a plane without space points near the road: no track from this seed
+    if (nCandidates == 0) return false;
+    road._line.pointsInRoad(nCandidates, candidates.data(), _spX[detID].data(), _spY[detID].data(),
+                            _spZ[detID].data(), getRoadWidth(k), roadMask(worker, k, nCandidates));
+  }
+  return true;
+}
+
+template <int NPlanes>
+template <int K>
+void SbtFixedPatRecAlg<NPlanes>::LoopOnPlane(std::integral_constant<int, K>, int* indices, int worker,
+                                             CandidateList& found) {
+  const std::vector<int>& candidates = _roadCandidates[worker * NPlanes + K];
+  int nCandidates = candidates.size();
+  uint64_t* inRoad = roadMask(worker, K, nCandidates);
+  for (int iCandidate = 0; iCandidate < nCandidates; iCandidate++) {
+    if (!SbtLineSegment::inMask(inRoad, iCandidate)) continue;
+    indices[K] = candidates[iCandidate];
+    LoopOnPlane(std::integral_constant<int, K + 1>(), indices, worker, found);
+  }
+}
+
+// all the inner space points are in the road: new candidate
+template <int NPlanes>
+void SbtFixedPatRecAlg<NPlanes>::LoopOnPlane(lastPlane, int* indices, int, CandidateList& found) {
+  std::vector<SbtSpacePoint*> SPList(NPlanes);
+  for (int k = 0; k < NPlanes; k++) {
+    SPList[k] = _detSpacePointList[_trackDetID[k]][indices[k]];
+  }
+  found.push_back(SPList);
+}
+
+template class SbtFixedPatRecAlg<4>;
+template class SbtFixedPatRecAlg<6>;
+template class SbtFixedPatRecAlg<8>;
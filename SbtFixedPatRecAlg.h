@@ -0,0 +1,66 @@
+#ifndef SBTFIXEDPATRECALG_HH
+#define SBTFIXEDPATRECALG_HH
+
+#include <type_traits>
+#include <vector>
+
+#include <TVector3.h>
+
+#include "SbtDef.h"
+#include "SbtLineSegment.h"
+#include "SbtPatRecAlg.h"
+#include "SbtSpacePointGrid.h"
+
+class SbtEvent;
+class SbtTrack;
+class SbtSpacePoint;
+class SbtDetectorElem;
+
+//
+// Description
+//
+// the Recursive pattern recognition for a number of tracking planes known
+// at compile time: the nested loops on the inner planes are unrolled by
+// the compiler and the space points of a candidate are kept in a
+// fixed-size array. The planes are ordered in z, so the candidates are not
+// sorted. Instantiated for 4, 6 and 8 planes.
+
+template <int NPlanes>
+class SbtFixedPatRecAlg : public SbtPatRecAlg {
+  static_assert(NPlanes >= 3, "SbtFixedPatRecAlg needs at least 3 planes");
+
+ public:
+  SbtFixedPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID);
+  ~SbtFixedPatRecAlg() {;}
+
+ protected:
+  // line through the space points of a seed on the outer planes
+  struct seedRoad {
+    TVector3 _front;
+    TVector3 _back;
+    SbtLineSegment _line;
+  };
+  typedef std::integral_constant<int, NPlanes - 1> lastPlane;
+
+  int _linkHits();
+  // find the space points of the inner planes in the road, in
+  // _roadCandidates and in the road masks of the worker; adds the number of
+  // road candidates tested to nRoadCandidates and returns false if a plane
+  // has none
+  bool findRoadCandidates(const seedRoad& road, int worker, int& nRoadCandidates);
+  // loop on the space points of plane K in the road, then on the next planes
+  template <int K>
+  void LoopOnPlane(std::integral_constant<int, K>, int* indices, int worker, CandidateList& found);
+  void LoopOnPlane(lastPlane, int* indices, int worker, CandidateList& found);
+
+  int _trkCounter;
+  int _nRoadCandidates;  // inner space points tested against a road
+
+  SbtSpacePointGrid _grid[NPlanes];  //!
+  // indices of the space points found in the current road, by worker and plane
+  std::vector<std::vector<int> > _roadCandidates;  //!
+
+  ClassDef(SbtFixedPatRecAlg, 1);
+};
+
+#endif
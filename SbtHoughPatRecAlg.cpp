@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <TVector3.h>
+
+#include "SbtDetectorElem.h"
+#include "SbtEvent.h"
+#include "SbtHoughPatRecAlg.h"
+#include "SbtLineSegment.h"
+#include "SbtSpacePoint.h"
+#include "SbtTrack.h"
+
+ClassImp(SbtHoughPatRecAlg);
+
+// upper limit on the accumulator size; the intercept bins are made larger
+// for events with a very wide spread of space points
+static const int maxNHoughBins = 1 << 22;
+
+SbtHoughPatRecAlg::SbtHoughPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID)
+    : SbtPatRecAlg(config, trackDetID), _zRef(0), _trkCounter(0) {
+  if (getDebugLevel() > 0) {
+    std::cout << "SbtHoughPatRecAlg: DebugLevel= " << getDebugLevel() << std::endl;
+  }
+  assert(_trackDetID.size() >= 3);
+  assert(_roadWidth > 0);
+  _algName = "Hough";
+
+  _maxSlope = config["houghMaxSlope"] ? config["houghMaxSlope"].as<double>() : 0.01;
+  // the intercept bins are binScale times the road, the bins are sized in
+  // each event from the largest road width of the planes
+  _binScale = config["houghBinScale"] ? config["houghBinScale"].as<double>() : 1.;
+  _interceptBin = 0;
+  _slopeBin = 0;
+  _roadSpread = 0;
+  assert(_maxSlope > 0);
+  assert(_binScale > 0);
+}
+
+void SbtHoughPatRecAlg::houghTransform(const std::vector<int>& points, int proj,
+                                       std::set<std::vector<int> >& peaks) {
+  const std::vector<double>& pos = _pos[proj];
+  unsigned short allPlanes = (1 << _nTrackDet) - 1;
+
+  int halfSlope = int(ceil(_maxSlope / _slopeBin));
+  int nSlope = 2 * halfSlope + 1;
+  double maxSlope = halfSlope * _slopeBin;
+
+  // intercept range of the lines within the slope range
+  double bMin = 1e30, bMax = -1e30;
+  for (int i : points) {
+    double dz = fabs(_z[i] - _zRef);
+    bMin = std::min(bMin, pos[i] - maxSlope * dz);
+    bMax = std::max(bMax, pos[i] + maxSlope * dz);
+  }
+  double interceptBin = _interceptBin;
+  int nIntercept = int((bMax - bMin) / interceptBin) + 2;
+  if ((double)nSlope * nIntercept > maxNHoughBins) {
+    nIntercept = maxNHoughBins / nSlope;
+    interceptBin = (bMax - bMin) / (nIntercept - 2);
+  }
+  // a window of nWindow adjacent bins contains any interval as large as the
+  // intercept spread of a track in the road
+  int nWindow = int(ceil(_roadSpread / interceptBin)) + 1;
+  nIntercept = std::max(nIntercept, nWindow);
+
+  // the vectors keep their capacity, so they are not reallocated; each
+  // slope row of _binPoints holds the (intercept bin, point) of the points
+  int nPoints = points.size();
+  _accumulator.assign(nSlope * nIntercept, 0);
+  _binPoints.resize(nSlope * nPoints);
+  for (int j = 0; j < nPoints; j++) {
+    int i = points[j];
+    unsigned short bit = 1 << _plane[i];
+    double dz = _z[i] - _zRef;
+    for (int iSlope = 0; iSlope < nSlope; iSlope++) {
+      double b = pos[i] - (iSlope - halfSlope) * _slopeBin * dz;
+      int iIntercept = int((b - bMin) / interceptBin);
+      _accumulator[iSlope * nIntercept + iIntercept] |= bit;
+      _binPoints[iSlope * nPoints + j] = std::make_pair(iIntercept, i);
+    }
+  }
+
+  // peaks are windows of adjacent intercept bins with votes from all
+  // planes; the points of a row are sorted by bin, so the points of the
+  // windows are found with two pointers moving along the row
+  std::vector<int> peak;
+  for (int iSlope = 0; iSlope < nSlope; iSlope++) {
+    const unsigned short* row = &_accumulator[iSlope * nIntercept];
+    auto first = _binPoints.begin() + iSlope * nPoints;
+    auto last = first + nPoints;
+    std::sort(first, last);
+    auto begin = first, end = first;
+    for (int iIntercept = 0; iIntercept + nWindow <= nIntercept; iIntercept++) {
+      unsigned short planes = 0;
+      for (int iBin = iIntercept; iBin < iIntercept + nWindow; iBin++) planes |= row[iBin];
+      if (planes != allPlanes) continue;
+      while (begin != last && begin->first < iIntercept) ++begin;
+      if (end < begin) end = begin;
+      while (end != last && end->first < iIntercept + nWindow) ++end;
+      peak.clear();
+      for (auto it = begin; it != end; ++it) peak.push_back(it->second);
+      // neighbouring windows of the same track give the same peak
+      std::sort(peak.begin(), peak.end());
+      peaks.insert(peak);
+    }
+  }
+}
+
+int SbtHoughPatRecAlg::_linkHits() {
+  // reset all the lists
+  for (int i = 0; i < maxNTelescopeDetector; i++) {
+    _detSpacePointList[i].clear();
+  }
+  // _trackDetID contains the telescope DetectorElemID ordered according to z
+  if (getDebugLevel()) {
+    std::cout << "SbtHoughPatRecAlg::linkHits " << std::endl;
+  }
+
+  _trkCounter = 0;
+  // tracks with space points on all Telescope Det are selected
+  if (_currentEvent->GetSpacePointList().size() < _trackDetID.size()) {
+    if (getDebugLevel()) {
+      std::cout << "WARNING: #" << _currentEvent->GetSpacePointList().size() << " Spacepoints found."
+           << "Skip the event" << std::endl;
+    }
+    return 0;
+  }
+
+  if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
+
+  // flat arrays of the tracking plane space points
+  _spacePoints.clear();
+  _pos[0].clear();
+  _pos[1].clear();
+  _z.clear();
+  _plane.clear();
+  for (int k = 0; k < _nTrackDet; k++) {
+    for (auto sp : _detSpacePointList[_trackDetID[k]]) {
+      _spacePoints.push_back(sp);
+      _pos[0].push_back(sp->GetXPosition());
+      _pos[1].push_back(sp->GetYPosition());
+      _z.push_back(sp->GetZPosition());
+      _plane.push_back(k);
+    }
+  }
+  double zMin = *std::min_element(_z.begin(), _z.end());
+  double zMax = *std::max_element(_z.begin(), _z.end());
+  _zRef = (zMin + zMax) / 2;
+  // the bins are sized from the largest road of the inner planes, the
+  // ones that are verified with the road
+  double roadWidth = 0;
+  for (int k = 1; k < _nTrackDet - 1; k++) roadWidth = std::max(roadWidth, getRoadWidth(k));
+  _interceptBin = _binScale * 2 * roadWidth;
+  // one slope bin moves the line by half an intercept bin at the ends
+  _slopeBin = _interceptBin / (zMax - zMin);
+  // the intercepts of the points of a track in the road spread over twice
+  // the road, projected, and over a quarter of a bin from the rounding of
+  // the slope to the nearest slope bin
+  _roadSpread = 2 * roadWidth * sqrt(1 + 2 * _maxSlope * _maxSlope) + _interceptBin / 4;
+
+  std::vector<int> allPoints(_spacePoints.size());
+  for (unsigned int i = 0; i < allPoints.size(); i++) allPoints[i] = i;
+
+  std::set<std::vector<int> > xPeaks;
+  houghTransform(allPoints, 0, xPeaks);
+
+  _foundTracks.clear();
+  int nPeaks = 0;
+  for (auto& xPeak : xPeaks) {
+    if (outOfTime()) break;
+    std::set<std::vector<int> > yPeaks;
+    houghTransform(xPeak, 1, yPeaks);
+    for (auto& yPeak : yPeaks) {
+      nPeaks++;
+      makeTracks(yPeak);
+    }
+  }
+
+  if (getDebugLevel() > 1) {
+    std::cout << "SbtHoughPatRecAlg: x peaks = " << xPeaks.size() << ", x-y peaks = " << nPeaks << std::endl;
+    std::cout << "SbtHoughPatRecAlg: trkCounter = " << _trkCounter << std::endl;
+  }
+  return _trkCounter;
+}
+
+int SbtHoughPatRecAlg::makeTracks(const std::vector<int>& points) {
+  for (int k = 0; k < _nTrackDet; k++) {
+    _planePoints[k].clear();
+  }
+  for (int i : points) {
+    _planePoints[_plane[i]].push_back(i);
+  }
+  int nTracks = _trkCounter;
+  _candidate.resize(_nTrackDet);
+  LoopOnPlanes(0);
+  return _trkCounter - nTracks;
+}
+
+void SbtHoughPatRecAlg::LoopOnPlanes(unsigned int k) {
+  if (k == (unsigned int)_nTrackDet) {
+    if (!isCandidateTrack()) return;
+    // the same space points may be found in more than one peak
+    if (!_foundTracks.insert(_candidate).second) return;
+    _currentEvent->AddTrack(SbtTrack(_candidate));
+    _trkCounter++;
+    return;
+  }
+  for (int i : _planePoints[k]) {
+    _candidate[k] = _spacePoints[i];
+    LoopOnPlanes(k + 1);
+  }
+}
+
+bool SbtHoughPatRecAlg::isCandidateTrack() const {
+  // the inner space points must be in the road of the outer ones
+  SbtLineSegment line(_candidate.front()->point(), _candidate.back()->point());
+  for (int k = 1; k < _nTrackDet - 1; k++) {
+    if (line.distance(_candidate[k]->point()) > getRoadWidth(k)) return false;
+  }
+  return true;
+}
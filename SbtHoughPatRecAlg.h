@@ -0,0 +1,69 @@
+#ifndef SBTHOUGHPATRECALG_HH
+#define SBTHOUGHPATRECALG_HH
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "SbtDef.h"
+#include "SbtPatRecAlg.h"
+
+class SbtEvent;
+class SbtTrack;
+class SbtSpacePoint;
+class SbtDetectorElem;
+
+//
+// Description
+//
+// Hough transform pattern recognition: every space point of the tracking
+// planes votes for the (slope, intercept) bins of the lines through it, in
+// the x-z projection first and then in the y-z projection of the space
+// points of each x-z peak. A window of adjacent intercept bins, as large as
+// the spread of the points of a track in the road, is a peak if all the
+// tracking planes voted in it. The space points of each peak are then
+// verified with the track road, so the cost grows linearly with the number
+// of space points.
+
+class SbtHoughPatRecAlg : public SbtPatRecAlg {
+ public:
+  SbtHoughPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID);
+  ~SbtHoughPatRecAlg() {;}
+
+ protected:
+  int _linkHits();
+  // fill the accumulator of projection proj (0 = x, 1 = y) with the given
+  // space points and add the space points of each peak to peaks
+  void houghTransform(const std::vector<int>& points, int proj, std::set<std::vector<int> >& peaks);
+  // make the track candidates from the space points of a peak
+  int makeTracks(const std::vector<int>& points);
+  void LoopOnPlanes(unsigned int k);
+  bool isCandidateTrack() const;
+
+  double _maxSlope;       // largest track slope in each projection
+  double _binScale;       // intercept bin size in units of the road
+  double _interceptBin;   // intercept bin size, from the largest road width
+  double _slopeBin;       // slope bin size, from the intercept bin and the telescope length
+  double _roadSpread;     // largest intercept spread of the points of a track in the road
+  double _zRef;           // intercepts are evaluated at _zRef
+
+  // tracking plane space points of the event
+  std::vector<SbtSpacePoint*> _spacePoints;
+  std::vector<double> _pos[2];
+  std::vector<double> _z;
+  std::vector<int> _plane;
+
+  // accumulator, one bit per tracking plane in each bin
+  std::vector<unsigned short> _accumulator;
+  // (intercept bin, space point) of each slope row of the accumulator
+  std::vector<std::pair<int, int> > _binPoints;
+
+  std::vector<int> _planePoints[maxNTelescopeDetector];
+  std::vector<SbtSpacePoint*> _candidate;
+  std::set<std::vector<SbtSpacePoint*> > _foundTracks;
+  int _trkCounter;
+
+  ClassDef(SbtHoughPatRecAlg, 1);
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
@@ -19,6 +20,58 @@ double SbtLineSegment::distance(const TVector3& x0) const {
   return d;
 }
 
+// identity index list for the dense form of pointsInRoad
+struct denseIndex {
+  int operator[](int i) const { return i; }
+};
+
+// the points are checked in blocks of 64: the squared distance from the
+// line is |d x w|^2 / |d|^2, with d the line direction and w the point
+// position relative to _x1, and it is compared with maxDistance^2 without
+// a division or a square root. The loop on a block has no branches, so the
+// compiler vectorizes it, and the results are then packed in the mask.
+template <class Index>
+static void roadMask(const TVector3& x1, const TVector3& x2, int n, Index index, const double* x,
+                     const double* y, const double* z, double maxDistance, uint64_t* mask) {
+  double o0 = x1.X(), o1 = x1.Y(), o2 = x1.Z();
+  double d0 = x2.X() - o0, d1 = x2.Y() - o1, d2 = x2.Z() - o2;
+  double dir2 = d0 * d0 + d1 * d1 + d2 * d2;
+  double cut = maxDistance * maxDistance * dir2;
+
+  for (int first = 0; first < n; first += 64) {
+    int nBlock = std::min(64, n - first);
+    uint64_t bits = 0;
+    if (dir2 == 0) {
+      // as distance(), all the points are on a line of zero length
+      if (maxDistance > 0) bits = nBlock == 64 ? ~uint64_t(0) : (uint64_t(1) << nBlock) - 1;
+    }
+    else {
+      unsigned char inside[64];
+      for (int i = 0; i < nBlock; i++) {
+        int j = index[first + i];
+        double w0 = x[j] - o0, w1 = y[j] - o1, w2 = z[j] - o2;
+        double c0 = d1 * w2 - d2 * w1;
+        double c1 = d2 * w0 - d0 * w2;
+        double c2 = d0 * w1 - d1 * w0;
+        inside[i] = c0 * c0 + c1 * c1 + c2 * c2 < cut;
+      }
+      for (int i = 0; i < nBlock; i++) bits |= uint64_t(inside[i]) << i;
+    }
+    mask[first / 64] = bits;
+  }
+  if (n % 64 == 0) mask[n / 64] = 0;
+}
+
+void SbtLineSegment::pointsInRoad(int n, const double* x, const double* y, const double* z,
+                                  double maxDistance, uint64_t* mask) const {
+  roadMask(_x1, _x2, n, denseIndex(), x, y, z, maxDistance, mask);
+}
+
+void SbtLineSegment::pointsInRoad(int n, const int* index, const double* x, const double* y,
+                                  const double* z, double maxDistance, uint64_t* mask) const {
+  roadMask(_x1, _x2, n, index, x, y, z, maxDistance, mask);
+}
+
 double SbtLineSegment::distance(const SbtLineSegment& line) const {
   auto u = _x2 - _x1;
   auto v = line._x2 - line._x1;
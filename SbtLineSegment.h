@@ -1,6 +1,8 @@
 #ifndef SBTLINESEGMENT_HH
 #define SBTLINESEGMENT_HH
 
+#include <cstdint>
+
 #include "SbtDef.h"
 
 #include <TVector3.h>
@@ -21,6 +23,16 @@ class SbtLineSegment {
   ~SbtLineSegment() {;}
 
   double distance(const TVector3& point) const;
+
+  // road check of many points at once: bit i of mask is set if point i,
+  // or point index[i] in the second form, is closer than maxDistance to
+  // the line. mask needs maskSize(n) words.
+  void pointsInRoad(int n, const double* x, const double* y, const double* z, double maxDistance,
+                    uint64_t* mask) const;
+  void pointsInRoad(int n, const int* index, const double* x, const double* y, const double* z,
+                    double maxDistance, uint64_t* mask) const;
+  static int maskSize(int n) { return n / 64 + 1; }
+  static bool inMask(const uint64_t* mask, int i) { return (mask[i / 64] >> (i % 64)) & 1; }
   double distance(const SbtLineSegment& line) const;
   TVector3 poca(const SbtLineSegment& line) const;
 
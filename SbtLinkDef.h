@@ -11,6 +11,9 @@
 #pragma link C++ class SbtAlignmentAlg+;
 #pragma link C++ class SbtBentCrystalFittingAlg+;
 #pragma link C++ class SbtBentCrystalPatRecAlg+;
+#pragma link C++ class SbtCKFPatRecAlg+;
+#pragma link C++ class SbtCellularAutomatonPatRecAlg+;
+#pragma link C++ class SbtChannelMask+;
 #pragma link C++ class SbtCluster+;
 #pragma link C++ class SbtClusteringAlg+;
 #pragma link C++ class SbtConfig+;
@@ -25,9 +28,13 @@
 #pragma link C++ class SbtEventRawReader+;
 #pragma link C++ class SbtEventReader+;
 #pragma link C++ class SbtFittingAlg+;
+#pragma link C++ class SbtFixedPatRecAlg<4>+;
+#pragma link C++ class SbtFixedPatRecAlg<6>+;
+#pragma link C++ class SbtFixedPatRecAlg<8>+;
 #pragma link C++ class SbtGenAlg+;
 #pragma link C++ class SbtGenerator+;
 #pragma link C++ class SbtHit+;
+#pragma link C++ class SbtHoughPatRecAlg+;
 #pragma link C++ class SbtIO+;
 #pragma link C++ class SbtLineSegment+;
 #pragma link C++ class SbtMakeClusters+;
@@ -50,9 +57,11 @@
 #pragma link C++ class SbtSingleSideDetectorElem+;
 #pragma link C++ class SbtSingleSidePatRecAlg+;
 #pragma link C++ class SbtSpacePoint+;
+#pragma link C++ class SbtSpacePointGrid+;
 #pragma link C++ class SbtStripDetectorElem+;
 #pragma link C++ class SbtStripletsDetectorElem+;
 #pragma link C++ class SbtTrack+;
 #pragma link C++ class SbtTrackViewer+;
 #pragma link C++ class SbtTriggerInfo+;
+#pragma link C++ class SbtWorkerPool+;
 #endif
@@ -1,39 +1,65 @@
 #include <algorithm>
 #include <cassert>
-#include <functional>
+#include <cmath>
 #include <iostream>
 
+#include "SbtChannelMask.h"
 #include "SbtClusteringAlg.h"
+#include "SbtDetectorElem.h"
+#include "SbtDetectorType.h"
 #include "SbtEvent.h"
 #include "SbtMakeClusters.h"
 #include "SbtPixelClusteringAlg.h"
 #include "SbtSimpleClusteringAlg.h"
+#include "SbtWorkerPool.h"
 
 ClassImp(SbtMakeClusters);
 
-SbtMakeClusters::SbtMakeClusters(std::string algorithm, std::string pxlClusteringOpt)
-    : _DebugLevel(0) {
+SbtMakeClusters::SbtMakeClusters(std::string algorithm, std::string pxlClusteringOpt, int nThreads)
+    : _DebugLevel(0),
+      _nThreads(std::max(nThreads, 1)),
+      _channelMask(nullptr),
+      _dutRoiWindow(0),
+      _workerPool(nullptr) {
   std::cout << "SbtMakeClusters:  DebugLevel= " << _DebugLevel << std::endl;
+  if (_nThreads > 1) {
+    std::cout << "SbtMakeClusters: clustering planes on " << _nThreads << " threads" << std::endl;
+    _workerPool = new SbtWorkerPool(_nThreads);
+  }
+
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    _isTrackingDet[iDet] = true;
+  }
 
   // instantiate the correct algorithm
-  if (algorithm == "Simple") {
-    _stripClusterAlg = new SbtSimpleClusteringAlg();
-    _pxlClusterAlg = new SbtPixelClusteringAlg(pxlClusteringOpt);
-  } 
-  else {
-    std::cout << "Invalid clustering algorithm specified: " << algorithm << std::endl;
-    assert(0);
+  for (int iWorker = 0; iWorker < _nThreads; iWorker++) {
+    if (algorithm == "Simple") {
+      _stripClusterAlgs.push_back(new SbtSimpleClusteringAlg());
+      _pxlClusterAlgs.push_back(new SbtPixelClusteringAlg(pxlClusteringOpt));
+    } 
+    else {
+      std::cout << "Invalid clustering algorithm specified: " << algorithm << std::endl;
+      assert(0);
+    }
   }
 }
 
 SbtMakeClusters::~SbtMakeClusters() {
-  delete _stripClusterAlg;
-  delete _pxlClusterAlg;
+  for (auto alg : _stripClusterAlgs) delete alg;
+  for (auto alg : _pxlClusterAlgs) delete alg;
+  delete _channelMask;
+  delete _workerPool;
+}
+
+void SbtMakeClusters::setChannelMask(SbtChannelMask* channelMask) {
+  delete _channelMask;
+  _channelMask = channelMask;
 }
 
 void SbtMakeClusters::makeClusters(SbtEvent* event) {
   makeStripClusters(event);
   makePxlClusters(event);
+  if (_channelMask) _channelMask->endEvent();
 }
 
 void SbtMakeClusters::makeStripClusters(SbtEvent* event) {
@@ -41,37 +67,72 @@ void SbtMakeClusters::makeStripClusters(SbtEvent* event) {
   // will be clustered independently
   orderStripDigis(event->GetStripDigiList());
 
-  // loop over layers and sides
+  // in the ROI mode the DUT planes are left to makeDutClusters
+  std::vector<int> planes;
   for (int iLayers = 0; iLayers < maxNTelescopeDetector; iLayers++) {
+    if (_dutRoiWindow > 0 && !_isTrackingDet[iLayers]) continue;
     for (int side = 0; side < 2; side++) {
-      if (_orderedStripDigis[iLayers][side].size() == 0) continue;
+      if (!_orderedStripDigis[iLayers][side].empty()) planes.push_back(2 * iLayers + side);
+    }
+  }
+  makeStripClusters(planes, event->GetStripClusterList());
+}
 
-      std::vector<SbtDigi*>::iterator aDigi;
-      if (_DebugLevel > 1) {
-        std::cout << "Ordered digis of layer/side " << iLayers << "/" << side
-             << "\n";
-      }
-      std::vector<SbtDigi*> Digis = _orderedStripDigis[iLayers][side];
-      if (_DebugLevel > 1)
-        std::cout << "  Sorting sub-list... "
-             << "\n";
-
-      // sort the digis in the sublist
-      SortStripDigis(Digis);
-      if (_DebugLevel > 1)
-        std::cout << "(MakeClusters)  sub-list Digi size is: " << Digis.size()
-             << "\n";
-
-      // do the clustering on the sub-list
-      int nclusters = _stripClusterAlg->Clusterize(Digis, event->GetStripClusterList());
-
-      if (_DebugLevel > 0) {
-        std::cout << " ----> " << nclusters
-             << " clusters found for layer/side: " << iLayers << "/" << side
-             << "\n";
-      }
-    }  // loop on sides
-  }    // loop on layers
+void SbtMakeClusters::makeStripClusters(const std::vector<int>& planes, std::vector<SbtCluster>& clusterList) {
+  if (_nThreads == 1) {
+    // loop over layers and sides
+    for (auto plane : planes) {
+      makeStripClusters(plane / 2, plane % 2, _stripClusterAlgs[0], clusterList);
+    }
+    return;
+  }
+
+  // each layer/side is a task writing into its own buffer
+  for (auto plane : planes) {
+    _stripClusterBuffer[plane / 2][plane % 2].clear();
+  }
+  _workerPool->run(planes.size(), [&](int iTask, int iWorker) {
+    int iLayers = planes[iTask] / 2;
+    int side = planes[iTask] % 2;
+    makeStripClusters(iLayers, side, _stripClusterAlgs[iWorker], _stripClusterBuffer[iLayers][side]);
+  });
+
+  // concatenate in layer/side order, as in the serial mode
+  for (auto plane : planes) {
+    std::vector<SbtCluster>& buffer = _stripClusterBuffer[plane / 2][plane % 2];
+    clusterList.insert(clusterList.end(), buffer.begin(), buffer.end());
+  }
+}
+
+int SbtMakeClusters::makeStripClusters(int iLayers, int side, SbtClusteringAlg* alg,
+                                       std::vector<SbtCluster>& clusterList) {
+  if (_orderedStripDigis[iLayers][side].size() == 0) return 0;
+
+  if (_DebugLevel > 1) {
+    std::cout << "Ordered digis of layer/side " << iLayers << "/" << side
+         << "\n";
+  }
+  // the sub-list is rebuilt for each event, so it can be sorted in place
+  std::vector<SbtDigi*>& Digis = _orderedStripDigis[iLayers][side];
+  if (_DebugLevel > 1)
+    std::cout << "  Sorting sub-list... "
+         << "\n";
+
+  // sort the digis in the sublist
+  SortStripDigis(iLayers, side);
+  if (_DebugLevel > 1)
+    std::cout << "(MakeClusters)  sub-list Digi size is: " << Digis.size()
+         << "\n";
+
+  // do the clustering on the sub-list
+  int nclusters = alg->Clusterize(Digis, clusterList);
+
+  if (_DebugLevel > 0) {
+    std::cout << " ----> " << nclusters
+         << " clusters found for layer/side: " << iLayers << "/" << side
+         << "\n";
+  }
+  return nclusters;
 }
 
 void SbtMakeClusters::makePxlClusters(SbtEvent* event) {
@@ -79,33 +140,143 @@ void SbtMakeClusters::makePxlClusters(SbtEvent* event) {
   // will be clustered independently
   orderPxlDigis(event->GetPxlDigiList());
 
-  // loop over layers
+  std::vector<int> planes;
   for (int iLayers = 0; iLayers < maxNDutDetector; iLayers++) {
-    if (_orderedPxlDigis[iLayers].size() == 0) continue;
+    if (_dutRoiWindow > 0 && !_isTrackingDet[iLayers]) continue;
+    if (!_orderedPxlDigis[iLayers].empty()) planes.push_back(iLayers);
+  }
+  makePxlClusters(planes, event->GetPxlClusterList());
+}
 
-    std::vector<SbtDigi*>::iterator aPxlDigi;
-    if (_DebugLevel > 0) {
-      std::cout << "Ordered digis of layer " << iLayers << "\n";
+void SbtMakeClusters::makePxlClusters(const std::vector<int>& planes, std::vector<SbtCluster>& clusterList) {
+  if (_nThreads == 1) {
+    // loop over layers
+    for (auto plane : planes) {
+      makePxlClusters(plane, _pxlClusterAlgs[0], clusterList);
     }
-    std::vector<SbtDigi*> Digis = _orderedPxlDigis[iLayers];
-    if (_DebugLevel > 1)
-      std::cout << "  Sorting sub-list... "
-           << "\n";
+    return;
+  }
 
-    // sort the digis in the sublist
-    SortPxlDigis(Digis);
+  for (auto plane : planes) {
+    _pxlClusterBuffer[plane].clear();
+  }
+  _workerPool->run(planes.size(), [&](int iTask, int iWorker) {
+    makePxlClusters(planes[iTask], _pxlClusterAlgs[iWorker], _pxlClusterBuffer[planes[iTask]]);
+  });
 
-    if (_DebugLevel > 0)
-      std::cout << "(MakeClusters)  sub-list Digi size is: " << Digis.size() << "\n";
+  for (auto plane : planes) {
+    clusterList.insert(clusterList.end(), _pxlClusterBuffer[plane].begin(), _pxlClusterBuffer[plane].end());
+  }
+}
 
-    // do the clustering on the sub-list
-    int nclusters = _pxlClusterAlg->Clusterize(Digis, event->GetPxlClusterList());
+int SbtMakeClusters::makePxlClusters(int iLayers, SbtClusteringAlg* alg,
+                                     std::vector<SbtCluster>& clusterList) {
+  if (_orderedPxlDigis[iLayers].size() == 0) return 0;
 
-    if (_DebugLevel > 0) {
-      std::cout << " ----> " << nclusters
-           << " clusters found for layer: " << iLayers << "\n";
+  if (_DebugLevel > 0) {
+    std::cout << "Ordered digis of layer " << iLayers << "\n";
+  }
+  std::vector<SbtDigi*>& Digis = _orderedPxlDigis[iLayers];
+  if (_DebugLevel > 1)
+    std::cout << "  Sorting sub-list... "
+         << "\n";
+
+  // sort the digis in the sublist
+  SortPxlDigis(Digis);
+
+  if (_DebugLevel > 0)
+    std::cout << "(MakeClusters)  sub-list Digi size is: " << Digis.size() << "\n";
+
+  // do the clustering on the sub-list
+  int nclusters = alg->Clusterize(Digis, clusterList);
+
+  if (_DebugLevel > 0) {
+    std::cout << " ----> " << nclusters
+         << " clusters found for layer: " << iLayers << "\n";
+  }
+  return nclusters;
+}
+
+void SbtMakeClusters::setDutRoi(const std::vector<int>& trackDetID, double window) {
+  _dutRoiWindow = window;
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    _isTrackingDet[iDet] = false;
+  }
+  for (auto detID : trackDetID) {
+    assert(detID < maxNDetector);
+    _isTrackingDet[detID] = true;
+  }
+  std::cout << "SbtMakeClusters: DUT planes clustered within " << _dutRoiWindow
+            << " of the track intercepts" << std::endl;
+}
+
+void SbtMakeClusters::makeDutClusters(SbtEvent* event) {
+  assert(_dutRoiWindow > 0);
+  std::vector<SbtCluster>& stripClusterList = event->GetDutStripClusterList();
+  std::vector<SbtCluster>& pxlClusterList = event->GetDutPxlClusterList();
+
+  // the digis were already split in planes by makeClusters; keep only
+  // the ones close to the track intercepts
+  std::vector<int> planes;
+  for (int iLayers = 0; iLayers < maxNTelescopeDetector; iLayers++) {
+    if (_isTrackingDet[iLayers]) continue;
+    for (int side = 0; side < 2; side++) {
+      if (selectDutRoiDigis(event, _orderedStripDigis[iLayers][side])) planes.push_back(2 * iLayers + side);
     }
-  }  // loop on layers
+  }
+  makeStripClusters(planes, stripClusterList);
+
+  planes.clear();
+  for (int iLayers = 0; iLayers < maxNDutDetector; iLayers++) {
+    if (_isTrackingDet[iLayers]) continue;
+    if (selectDutRoiDigis(event, _orderedPxlDigis[iLayers])) planes.push_back(iLayers);
+  }
+  makePxlClusters(planes, pxlClusterList);
+
+  if (_DebugLevel > 0) {
+    std::cout << "SbtMakeClusters::makeDutClusters: " << stripClusterList.size() << " strip and "
+              << pxlClusterList.size() << " pixel DUT clusters" << std::endl;
+  }
+}
+
+int SbtMakeClusters::selectDutRoiDigis(SbtEvent* event, std::vector<SbtDigi*>& digis) {
+  if (digis.empty()) return 0;
+
+  // track intercepts in the local frame of the plane
+  const SbtDetectorElem* detElem = digis[0]->GetDetectorElem();
+  SbtDetectorType* detType = detElem->GetDetectorType();
+  std::vector<TVector3> intercepts;
+  for (auto& track : event->GetTrackList()) {
+    TVector3 point, localPoint;
+    track.IntersectPlane(detElem, point);
+    detElem->MasterToLocal(point, localPoint);
+    intercepts.push_back(localPoint);
+  }
+
+  double window = _dutRoiWindow;
+  auto outsideRoi = [&](SbtDigi* digi) {
+    if (digi->GetType() == SbtEnums::pixel) {
+      double pos[2];
+      digi->Position(pos);
+      for (auto& p : intercepts) {
+        if (fabs(pos[0] - p.X()) < window && fabs(pos[1] - p.Y()) < window) return false;
+      }
+      return true;
+    }
+    // distance in the plane between the intercept and the strip line
+    TVector3 x1, x2;
+    detType->GetEndPoints(digi->GetSide(), digi->Position(), x1, x2);
+    double dx = x2.X() - x1.X();
+    double dy = x2.Y() - x1.Y();
+    double length = sqrt(dx * dx + dy * dy);
+    for (auto& p : intercepts) {
+      double cross = dx * (p.Y() - x1.Y()) - dy * (p.X() - x1.X());
+      if (fabs(cross) < window * length) return false;
+    }
+    return true;
+  };
+  digis.erase(std::remove_if(digis.begin(), digis.end(), outsideRoi), digis.end());
+  return digis.size();
 }
 
 void SbtMakeClusters::orderStripDigis(std::vector<SbtDigi>& eventStripDigiList) {
@@ -118,6 +289,14 @@ void SbtMakeClusters::orderStripDigis(std::vector<SbtDigi>& eventStripDigiList)
       std::cout << "layer is: " << aStripDigi.GetLayer()
            << "; side is: " << aStripDigi.GetSide() << "\n";
     }
+    if (_channelMask) {
+      if (_channelMask->isLearning()) {
+        _channelMask->fill(aStripDigi);
+      }
+      else if (_channelMask->isMasked(aStripDigi)) {
+        continue;
+      }
+    }
     _orderedStripDigis[aStripDigi.GetLayer()][aStripDigi.GetSide()].push_back(&aStripDigi);
   }
 
@@ -145,6 +324,14 @@ void SbtMakeClusters::orderPxlDigis(std::vector<SbtDigi>& eventPxlDigiList) {
            << "; row : " << aPxlDigi.GetRow()
            << "; column : " << aPxlDigi.GetColumn() << "\n";
     }
+    if (_channelMask) {
+      if (_channelMask->isLearning()) {
+        _channelMask->fill(aPxlDigi);
+      }
+      else if (_channelMask->isMasked(aPxlDigi)) {
+        continue;
+      }
+    }
     _orderedPxlDigis[aPxlDigi.GetLayer()].push_back(&aPxlDigi);
   }
   if (_DebugLevel > 0) {
@@ -155,9 +342,37 @@ void SbtMakeClusters::orderPxlDigis(std::vector<SbtDigi>& eventPxlDigiList) {
   }
 }
 
-void SbtMakeClusters::SortStripDigis(std::vector<SbtDigi*>& digiList) {
+void SbtMakeClusters::SortStripDigis(int layer, int side) {
+  std::vector<SbtDigi*>& digiList = _orderedStripDigis[layer][side];
+  std::vector<int>& channel = _stripChannel[layer][side];
+  std::vector<int>& channelCount = _stripChannelCount[layer][side];
+  std::vector<SbtDigi*>& sortedDigis = _sortedStripDigis[layer][side];
   assert(digiList.at(0)->GetType() == SbtEnums::strip);
-  std::sort(digiList.begin(), digiList.end(), SbtMakeClusters::stripLt);
+  // counting sort on the channel number: the digis of one layer/side are
+  // bucketed into a dense array spanning their channel range, which orders
+  // them in O(nDigi + nChannel) without any comparator call
+  int nDigi = digiList.size();
+  channel.resize(nDigi);
+  int minCh = digiList[0]->GetChannelNumber();
+  int maxCh = minCh;
+  for (int iDigi = 0; iDigi < nDigi; iDigi++) {
+    int ch = digiList[iDigi]->GetChannelNumber();
+    channel[iDigi] = ch;
+    if (ch < minCh) minCh = ch;
+    if (ch > maxCh) maxCh = ch;
+  }
+  channelCount.assign(maxCh - minCh + 2, 0);
+  for (int iDigi = 0; iDigi < nDigi; iDigi++) {
+    ++channelCount[channel[iDigi] - minCh + 1];
+  }
+  for (unsigned int iCh = 1; iCh < channelCount.size(); iCh++) {
+    channelCount[iCh] += channelCount[iCh - 1];
+  }
+  sortedDigis.resize(nDigi);
+  for (int iDigi = 0; iDigi < nDigi; iDigi++) {
+    sortedDigis[channelCount[channel[iDigi] - minCh]++] = digiList[iDigi];
+  }
+  digiList.swap(sortedDigis);
 }
 
 void SbtMakeClusters::SortPxlDigis(std::vector<SbtDigi*>& digiList) {
@@ -165,11 +380,6 @@ void SbtMakeClusters::SortPxlDigis(std::vector<SbtDigi*>& digiList) {
   std::sort(digiList.begin(), digiList.end(), SbtMakeClusters::pxlLt);
 }
 
-bool SbtMakeClusters::stripLt(SbtDigi* d1, SbtDigi* d2) {
-  assert(d1->GetType() == SbtEnums::strip);
-  return (d1->GetChannelNumber() < d2->GetChannelNumber());
-}
-
 bool SbtMakeClusters::pxlLt(SbtDigi* d1, SbtDigi* d2) {
   assert(d1->GetType() == SbtEnums::pixel);
   if (d1->GetRow() != d2->GetRow())
@@ -9,44 +9,92 @@
 #include "SbtDigi.h"
 
 class SbtEvent;
+class SbtChannelMask;
 class SbtClusteringAlg;
+class SbtWorkerPool;
 
 class SbtMakeClusters {
  public:
-  SbtMakeClusters(std::string algorithm, std::string pxlClusteringOpt);
+  // nThreads > 1 enables the concurrent clustering of the planes
+  SbtMakeClusters(std::string algorithm, std::string pxlClusteringOpt, int nThreads = 1);
   virtual ~SbtMakeClusters();
   void setDebugLevel(int debugLevel) { _DebugLevel = debugLevel; }
   inline int getDebugLevel() { return _DebugLevel; }
+  int getNThreads() const { return _nThreads; }
+
+  // noisy channel mask, owned by this object; digis of masked
+  // channels are dropped before clustering
+  void setChannelMask(SbtChannelMask* channelMask);
+  SbtChannelMask* getChannelMask() const { return _channelMask; }
 
   void makeClusters(SbtEvent* event);
 
+  // lazy DUT reconstruction: once setDutRoi is called, makeClusters only
+  // clusters the tracking planes. After the tracks are fitted,
+  // makeDutClusters clusters the digis of the other planes lying within
+  // window (local coordinates) of a track intercept into the DUT cluster
+  // lists of the event. SbtConfig::reconstructEvent runs this pass.
+  void setDutRoi(const std::vector<int>& trackDetID, double window);
+  bool isDutRoi() const { return _dutRoiWindow > 0; }
+  void makeDutClusters(SbtEvent* event);
+
  protected:
   int _DebugLevel;
+  int _nThreads;
+  SbtChannelMask* _channelMask;
+
+  double _dutRoiWindow;  // ROI mode is off if not positive
+  bool _isTrackingDet[maxNDetector];
 
-  SbtClusteringAlg* _stripClusterAlg;
-  SbtClusteringAlg* _pxlClusterAlg;
+  // the workers of the concurrent clustering, started once
+  SbtWorkerPool* _workerPool;  //!
+
+  // one algorithm instance per worker thread, since the algorithms
+  // keep internal work buffers
+  std::vector<SbtClusteringAlg*> _stripClusterAlgs;
+  std::vector<SbtClusteringAlg*> _pxlClusterAlgs;
 
   // strip digis order by layer/side
   std::vector<SbtDigi*> _orderedStripDigis[maxNTelescopeDetector][2];
   // pixel digis order by layer
   std::vector<SbtDigi*> _orderedPxlDigis[maxNDutDetector];
 
+  // work buffers for the strip counting sort, one per layer/side
+  std::vector<int> _stripChannel[maxNTelescopeDetector][2];
+  std::vector<int> _stripChannelCount[maxNTelescopeDetector][2];
+  std::vector<SbtDigi*> _sortedStripDigis[maxNTelescopeDetector][2];
+
+  // per-plane cluster buffers used in the parallel mode
+  std::vector<SbtCluster> _stripClusterBuffer[maxNTelescopeDetector][2];
+  std::vector<SbtCluster> _pxlClusterBuffer[maxNDutDetector];
+
   void makeStripClusters(SbtEvent* event);
   void makePxlClusters(SbtEvent* event);
 
+  // cluster a list of planes (2 * layer + side for strips), appending to clusterList
+  void makeStripClusters(const std::vector<int>& planes, std::vector<SbtCluster>& clusterList);
+  void makePxlClusters(const std::vector<int>& planes, std::vector<SbtCluster>& clusterList);
+
+  // cluster a single plane, appending to clusterList
+  int makeStripClusters(int layer, int side, SbtClusteringAlg* alg, std::vector<SbtCluster>& clusterList);
+  int makePxlClusters(int layer, SbtClusteringAlg* alg, std::vector<SbtCluster>& clusterList);
+
+  // keep the digis lying in the ROI of the event tracks, returns their number
+  int selectDutRoiDigis(SbtEvent* event, std::vector<SbtDigi*>& digis);
+
+
   // this method reorder the digis in the event
   // the orderedDigis array is filled accordingly
   void orderStripDigis(std::vector<SbtDigi>& eventStripDigiList);
   void orderPxlDigis(std::vector<SbtDigi>& eventStripDigiList);
 
-  // sort a list of digis
-  void SortStripDigis(std::vector<SbtDigi*>& stripDigiList);
+  // sort the digis of a layer/side (strips by channel with a counting sort)
+  void SortStripDigis(int layer, int side);
   void SortPxlDigis(std::vector<SbtDigi*>& pxlDigiList);
 
   // append clusters to overall list
   void AppendClusters(std::vector<SbtCluster>& clusterList);
 
-  static bool stripLt(SbtDigi* d1, SbtDigi* d2);
   static bool pxlLt(SbtDigi* d1, SbtDigi* d2);
 
   ClassDef(SbtMakeClusters, 1);
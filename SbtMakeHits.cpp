@@ -15,7 +15,19 @@ void SbtMakeHits::makeHits(SbtEvent* event) {
     std::cout << "SbtMakeHits::makeHits" << std::endl;
   }
 
-  for (auto& cluster : event->GetStripClusterList()) {
-    event->AddHit(SbtHit(&cluster));
+  makeHits(event->GetStripClusterList(), event->GetHitList());
+}
+
+void SbtMakeHits::makeDutHits(SbtEvent* event) {
+  if (_DebugLevel) {
+    std::cout << "SbtMakeHits::makeDutHits" << std::endl;
+  }
+
+  makeHits(event->GetDutStripClusterList(), event->GetDutHitList());
+}
+
+void SbtMakeHits::makeHits(std::vector<SbtCluster>& clusterList, std::vector<SbtHit>& hitList) {
+  for (auto& cluster : clusterList) {
+    hitList.push_back(SbtHit(&cluster));
   }
 }
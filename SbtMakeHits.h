@@ -4,6 +4,7 @@
 #include <vector>
 #include "SbtDef.h"
 
+class SbtCluster;
 class SbtEvent;
 class SbtHit;
 
@@ -15,8 +16,13 @@ class SbtMakeHits {
   int getDebugLevel() const { return _DebugLevel; }
 
   void makeHits(SbtEvent* event);
+  // hits of the DUT strip clusters made in the ROI mode
+  void makeDutHits(SbtEvent* event);
 
  protected:
+  // one hit per strip cluster, appended to hitList
+  void makeHits(std::vector<SbtCluster>& clusterList, std::vector<SbtHit>& hitList);
+
   int _DebugLevel;
 
   ClassDef(SbtMakeHits, 1);
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "SbtCluster.h"
+#include "SbtDetectorElem.h"
 #include "SbtDetectorType.h"
 #include "SbtEvent.h"
 #include "SbtHit.h"
@@ -12,13 +13,31 @@
 ClassImp(SbtMakeSpacePoints);
 
 SbtMakeSpacePoints::SbtMakeSpacePoints(std::string ErrorMethod, double trackDetErr)
-    : _DebugLevel(0) {
+    : _DebugLevel(0), _rejectUncorrelated(false) {
   std::cout << "SbtMakeSpacePoints:  DebugLevel= " << _DebugLevel << std::endl;
   _errorMethod = ErrorMethod;
   _trackDetErr = trackDetErr;
 
   if (_DebugLevel)
     std::cout << "SbtMakeSpacePoints:  _errorMethod = " << _errorMethod << std::endl;
+
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    _isSingleSide[iDet] = -1;
+    _useChargeCorrelation[iDet] = false;
+    _chargeRatioMin[iDet] = 0.;
+    _chargeRatioMax[iDet] = 0.;
+  }
+}
+
+void SbtMakeSpacePoints::setChargeCorrelation(int detID, double minRatio, double maxRatio) {
+  if (detID < 0 || detID >= maxNDetector || minRatio < 0 || maxRatio < minRatio) {
+    std::cout << "SbtMakeSpacePoints::setChargeCorrelation: invalid window for detector "
+              << detID << ": [" << minRatio << ", " << maxRatio << "]" << std::endl;
+    assert(0);
+  }
+  _useChargeCorrelation[detID] = true;
+  _chargeRatioMin[detID] = minRatio;
+  _chargeRatioMax[detID] = maxRatio;
 }
 
 //
@@ -28,19 +47,53 @@ SbtMakeSpacePoints::SbtMakeSpacePoints(std::string ErrorMethod, double trackDetE
 // get a space point for each pixel hit
 //
 void SbtMakeSpacePoints::makeSpacePoints(SbtEvent* event) {
+  makeSpacePoints(event->GetHitList(), event->GetPxlClusterList(), event->GetSpacePointList());
+}
+
+void SbtMakeSpacePoints::makeDutSpacePoints(SbtEvent* event) {
+  makeSpacePoints(event->GetDutHitList(), event->GetDutPxlClusterList(), event->GetDutSpacePointList());
+}
+
+void SbtMakeSpacePoints::makeSpacePoints(std::vector<SbtHit>& hitList, std::vector<SbtCluster>& pxlClusterList,
+                                         std::vector<SbtSpacePoint>& spList) {
   // create a List of SpacePoint for each Telescope detector
 
-  for (auto& hit1 : event->GetHitList()) {
-    if (hit1.GetDetectorElem()->GetDetectorType()->GetType() == "singleside") {
+  // bucket the hits by detector and side, so that U and V hits are
+  // only paired within the same detector
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    _hitBuckets[iDet][SbtEnums::U].clear();
+    _hitBuckets[iDet][SbtEnums::V].clear();
+    _singleSideHits[iDet].clear();
+  }
+  for (auto& hit : hitList) {
+    const SbtDetectorElem* detElem = hit.GetDetectorElem();
+    int detID = detElem->GetID();
+    assert(detID < maxNDetector);
+    // the detector type of a given ID is looked up only once
+    if (_isSingleSide[detID] < 0) {
+      _isSingleSide[detID] = detElem->GetDetectorType()->GetType() == "singleside";
+    }
+    if (_isSingleSide[detID]) {
+      _singleSideHits[detID].push_back(&hit);
+    }
+    else if (hit.GetSide() == SbtEnums::U || hit.GetSide() == SbtEnums::V) {
+      _hitBuckets[detID][hit.GetSide()].push_back(&hit);
+    }
+  }
+
+  int nPairs = 0;
+  int nUncorrelated = 0;
+  for (int iDet = 0; iDet < maxNDetector; iDet++) {
+    for (auto hit1 : _singleSideHits[iDet]) {
       TVector3 point(-999., -999., -999);
-      if (hit1.isOnSingleSide(point)) {
+      if (hit1->isOnSingleSide(point)) {
         // fill the SpacePoint list corresponding to the DetElemID
-        event->AddSpacePoint(SbtSpacePoint(point, hit1.GetDetectorElem(), &hit1, _errorMethod, _trackDetErr));
+        spList.push_back(SbtSpacePoint(point, hit1->GetDetectorElem(), hit1, _errorMethod, _trackDetErr));
 
         if (_DebugLevel > 1) {
           std::cout << "SbtMakeSpacePoints::CreateSpacePoints() new point" << std::endl
                << "  "
-               << "DetElemID = " << hit1.GetDetectorElem()->GetID()
+               << "DetElemID = " << iDet
                << " "
                << "point = " << point[0] << " " << point[1] << " " << point[2]
                << std::endl;
@@ -48,51 +101,120 @@ void SbtMakeSpacePoints::makeSpacePoints(SbtEvent* event) {
       }
     }
 
-    else {
-      if (hit1.GetSide() != SbtEnums::view::U) continue;
-      for (auto& hit2 : event->GetHitList()) {
-        if (hit2.GetSide() != SbtEnums::view::V) continue;
-        if (_DebugLevel > 3) {
-          std::cout << "consider"
-               << " hit1, detid=" << hit1.GetDetectorElem()->GetID()
-               << " side=" << hit1.GetSide()
-               << " hit2, detid=" << hit2.GetDetectorElem()->GetID()
-               << " side=" << hit2.GetSide() << std::endl;
-        }
-        if ((hit1.GetDetectorElem()->GetID() == hit2.GetDetectorElem()->GetID())) {
-          if (_DebugLevel > 2) {
-            std::cout << "SbtMakeSpacePoints::CreateSpacePoints() DetElemID =  "
-                 << hit1.GetDetectorElem()->GetID() << std::endl;
-          }
-
-          TVector3 point(-999., -999., -999);
-          if (hit1.Intersection(hit2, point)) {
-            // fill the SpacePoint list corresponding to the DetElemID
-            event->AddSpacePoint(SbtSpacePoint(point, hit1.GetDetectorElem(), &hit1, &hit2, _errorMethod, _trackDetErr));
-
-            if (_DebugLevel > 1) {
-              std::cout << "SbtMakeSpacePoints::CreateSpacePoints() new point"
-                   << std::endl
-                   << "  "
-                   << "DetElemID= "
-                   << hit1.GetDetectorElem()->GetID() << " "
-                   << "point= " << point[0] << " " << point[1] << " "
-                   << point[2] << std::endl;
-            }
-          }
-        }
-      }
+    if (!_hitBuckets[iDet][SbtEnums::U].empty() && !_hitBuckets[iDet][SbtEnums::V].empty()) {
+      nPairs += intersectPlane(spList, iDet, nUncorrelated);
     }
   }
   // consider here SP from pixel detectors
   //
-  for (auto& pixelCluster : event->GetPxlClusterList()) {
+  for (auto& pixelCluster : pxlClusterList) {
     // fill the SpacePoint List with the pixel SP
-    event->AddSpacePoint(SbtSpacePoint(&pixelCluster, _errorMethod, _trackDetErr));
+    spList.push_back(SbtSpacePoint(&pixelCluster, _errorMethod, _trackDetErr));
   }
 
   if (_DebugLevel) {
     std::cout << "SbtMakeSpacePoints::makeSpacePoints()" << std::endl;
-    std::cout << "Size SpacePointList = " << event->GetSpacePointList().size() << std::endl;
+    std::cout << "Size SpacePointList = " << spList.size() << std::endl;
+    std::cout << "U/V hit pairs tested = " << nPairs << std::endl;
+    std::cout << "U/V hit pairs not charge correlated = " << nUncorrelated << std::endl;
+  }
+}
+
+//
+// All the U x V pairs of a detector are processed together: the pair
+// coordinates are laid out in flat arrays, the active area (and the charge
+// correlation) is evaluated in one pass over all the pairs, and only the
+// accepted pairs are transformed to the master frame and stored.
+// This gives the same space points as SbtHit::Intersection, in the same
+// order.
+//
+int SbtMakeSpacePoints::intersectPlane(std::vector<SbtSpacePoint>& spList, int detID, int& nUncorrelated) {
+  std::vector<SbtHit*>& uHits = _hitBuckets[detID][SbtEnums::U];
+  std::vector<SbtHit*>& vHits = _hitBuckets[detID][SbtEnums::V];
+  const SbtDetectorElem* detElem = uHits.front()->GetDetectorElem();
+  // as in SbtHit::Intersection, only telescope detectors give space points
+  if (detID >= maxNTelescopeDetector) return 0;
+
+  int nU = uHits.size();
+  int nV = vHits.size();
+  int nPairs = nU * nV;
+  _pairU.resize(nPairs);
+  _pairV.resize(nPairs);
+  _pairOk.resize(nPairs);
+  for (int i = 0; i < nU; i++) {
+    double u = uHits[i]->GetCluster()->GetPosition();
+    double* pairU = &_pairU[i * nV];
+    double* pairV = &_pairV[i * nV];
+    for (int j = 0; j < nV; j++) {
+      pairU[j] = u;
+      pairV[j] = vHits[j]->GetCluster()->GetPosition();
+    }
+  }
+  detElem->InActiveArea(nPairs, _pairU.data(), _pairV.data(), _pairOk.data());
+
+  bool useChargeCorrelation = _useChargeCorrelation[detID];
+  if (useChargeCorrelation) {
+    // V/U pulse-height ratio; a failed correlation only vetoes the pair
+    // when rejection is enabled
+    _pairRatio.resize(nPairs);
+    double ratioMin = _chargeRatioMin[detID];
+    double ratioMax = _chargeRatioMax[detID];
+    for (int i = 0; i < nU; i++) {
+      double uPH = uHits[i]->GetCluster()->GetPulseHeight();
+      double* pairRatio = &_pairRatio[i * nV];
+      for (int j = 0; j < nV; j++) {
+        double vPH = vHits[j]->GetCluster()->GetPulseHeight();
+        pairRatio[j] = uPH > 0 ? vPH / uPH : -1.;
+      }
+    }
+    for (int k = 0; k < nPairs; k++) {
+      bool correlated = _pairRatio[k] >= ratioMin && _pairRatio[k] <= ratioMax;
+      nUncorrelated += !correlated;
+      if (_rejectUncorrelated) _pairOk[k] &= correlated;
+    }
+  }
+
+  // compact the accepted pairs and transform them together
+  _pairIndex.clear();
+  for (int k = 0; k < nPairs; k++) {
+    if (_pairOk[k]) _pairIndex.push_back(k);
+  }
+  int nPoints = _pairIndex.size();
+  if (nPoints == 0) return nPairs;
+  _localZ.assign(nPoints, 0.);
+  _masterX.resize(nPoints);
+  _masterY.resize(nPoints);
+  _masterZ.resize(nPoints);
+  for (int p = 0; p < nPoints; p++) {
+    int k = _pairIndex[p];
+    _pairU[p] = _pairU[k];
+    _pairV[p] = _pairV[k];
+  }
+  detElem->LocalToMaster(nPoints, _pairU.data(), _pairV.data(), _localZ.data(), _masterX.data(), _masterY.data(),
+                         _masterZ.data());
+
+  for (int p = 0; p < nPoints; p++) {
+    int k = _pairIndex[p];
+    SbtHit* hitU = uHits[k / nV];
+    SbtHit* hitV = vHits[k % nV];
+    TVector3 point(_masterX[p], _masterY[p], _masterZ[p]);
+    SbtSpacePoint spacePoint(point, detElem, hitU, hitV, _errorMethod, _trackDetErr);
+    if (useChargeCorrelation) {
+      double ratio = _pairRatio[k];
+      spacePoint.SetChargeCorrelation(ratio, ratio >= _chargeRatioMin[detID] && ratio <= _chargeRatioMax[detID]);
+    }
+    spList.push_back(spacePoint);
+
+    if (_DebugLevel > 1) {
+      std::cout << "SbtMakeSpacePoints::CreateSpacePoints() new point"
+           << std::endl
+           << "  "
+           << "DetElemID= "
+           << detID << " "
+           << "point= " << point[0] << " " << point[1] << " "
+           << point[2] << " "
+           << "charge ratio= " << spacePoint.GetChargeRatio() << std::endl;
+    }
   }
+  return nPairs;
 }
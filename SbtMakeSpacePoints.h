@@ -1,9 +1,15 @@
 #ifndef SBTMAKESPACEPOINTS_HH
 #define SBTMAKESPACEPOINTS_HH
 
+#include <string>
 #include <vector>
 
+#include "SbtDef.h"
+
+class SbtCluster;
+class SbtDetectorElem;
 class SbtEvent;
+class SbtHit;
 class SbtSpacePoint;
 
 class SbtMakeSpacePoints {
@@ -14,13 +20,51 @@ class SbtMakeSpacePoints {
   int getDebugLevel() const { return _DebugLevel; }
 
   void makeSpacePoints(SbtEvent* event);
+  // space points of the DUT hits and pixel clusters made in the ROI mode
+  void makeDutSpacePoints(SbtEvent* event);
+
+  // U/V pulse-height correlation: a space point of detector detID is
+  // correlated if the V/U pulse-height ratio is in [minRatio, maxRatio].
+  // Uncorrelated space points are only flagged unless rejection is enabled
+  void setChargeCorrelation(int detID, double minRatio, double maxRatio);
+  void setRejectUncorrelated(bool reject) { _rejectUncorrelated = reject; }
+  bool getRejectUncorrelated() const { return _rejectUncorrelated; }
 
  protected:
+  // space points of hitList and pxlClusterList, appended to spList
+  void makeSpacePoints(std::vector<SbtHit>& hitList, std::vector<SbtCluster>& pxlClusterList,
+                       std::vector<SbtSpacePoint>& spList);
+  // intersect all the U and V hits of a double sided detector and add the
+  // space points in the active area; returns the number of pairs tested
+  int intersectPlane(std::vector<SbtSpacePoint>& spList, int detID, int& nUncorrelated);
+
   int _DebugLevel;
   std::string _errorMethod;
   double _trackDetErr;  // nominal tracking error for spacePoints (used in the
                         // trk chi2 evalutation)
 
+  // hits of the event by detector ID and side
+  std::vector<SbtHit*> _hitBuckets[maxNDetector][2];
+  std::vector<SbtHit*> _singleSideHits[maxNDetector];
+  int _isSingleSide[maxNDetector];  // -1 until the first hit on the detector
+
+  // calibrated V/U pulse-height ratio window per detector ID
+  bool _useChargeCorrelation[maxNDetector];
+  double _chargeRatioMin[maxNDetector];
+  double _chargeRatioMax[maxNDetector];
+  bool _rejectUncorrelated;
+
+  // work arrays of the U x V intersection, one entry per pair
+  std::vector<double> _pairU;
+  std::vector<double> _pairV;
+  std::vector<double> _pairRatio;
+  std::vector<unsigned char> _pairOk;
+  std::vector<int> _pairIndex;
+  std::vector<double> _localZ;
+  std::vector<double> _masterX;
+  std::vector<double> _masterY;
+  std::vector<double> _masterZ;
+
   ClassDef(SbtMakeSpacePoints, 1);
 };
 
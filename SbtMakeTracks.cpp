@@ -1,8 +1,16 @@
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
+#include <TVector3.h>
+
+#include "SbtCKFPatRecAlg.h"
+#include "SbtCellularAutomatonPatRecAlg.h"
 #include "SbtEvent.h"
 #include "SbtFittingAlg.h"
+#include "SbtFixedPatRecAlg.h"
+#include "SbtHoughPatRecAlg.h"
+#include "SbtLineSegment.h"
 #include "SbtMakeTracks.h"
 #include "SbtPatRecAlg.h"
 #include "SbtRecursivePatRecAlg.h"
@@ -19,88 +27,161 @@ ClassImp(SbtMakeTracks);
 
 SbtMakeTracks::SbtMakeTracks(const YAML::Node& config, std::vector<int> trackDetID)
     : _DebugLevel(0),
+      _maxSharedSpacePoints(-1),
+      _nOverBudget(0),
+      _nFallback(0),
+      _nSkipped(0),
+      _fallbackPatRecAlg(nullptr),
       _trackDetID(trackDetID) {
   std::cout << "SbtMakeTracks:  DebugLevel= " << _DebugLevel << std::endl;
 
+  if (config["maxSharedSpacePoints"]) {
+    _maxSharedSpacePoints = config["maxSharedSpacePoints"].as<int>();
+  }
+
   std::string patRecAlg = config["patternRecognition"].as<std::string>();
   std::string fittingAlg = config["fitting"].as<std::string>();
 
   // instantiate the correct algorithms
-  if (patRecAlg == "Simple") {
-    _patRecAlg = new SbtSimplePatRecAlg(config, _trackDetID);
+  _patRecAlg = newPatRecAlg(patRecAlg, config);
+  // cheaper algorithm for the events over the budget of the first one. It
+  // runs on a single thread, so that it does not keep a second pool of
+  // idle workers. Only the time budget applies to it, since the events it
+  // sees are all over the combinations budget: fallbackMaxPatRecTime, or
+  // maxPatRecTime if it is not given; zero means no limit
+  if (config["patRecFallback"]) {
+    YAML::Node fallbackConfig = YAML::Clone(config);
+    fallbackConfig["patRecThreads"] = 1;
+    _fallbackPatRecAlg = newPatRecAlg(config["patRecFallback"].as<std::string>(), fallbackConfig);
+    double maxTime = config["fallbackMaxPatRecTime"] ? config["fallbackMaxPatRecTime"].as<double>()
+                                                     : _fallbackPatRecAlg->getMaxTime();
+    _fallbackPatRecAlg->setBudget(0, maxTime);
+  }
+
+  if (fittingAlg == "Simple") {
+    _fittingAlg = new SbtSimpleFittingAlg();
+
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << _patRecAlg->getAlgName()
+      std::cout << "SbtMakeTracks c'tor : _fittingAlg Simple = " << _fittingAlg->getAlgName() << std::endl;
+    }
+  } 
+  else if (fittingAlg == "Simple3D") {
+    _fittingAlg = new SbtSimple3DFittingAlg();
+
+    if (_DebugLevel) {
+      std::cout << "SbtMakeTracks c'tor : _fittingAlg Simple3D = " << _fittingAlg->getAlgName() << std::endl;
+    }
+  }
+  else if (fittingAlg == "BentCrystal") {
+    _fittingAlg = new SbtBentCrystalFittingAlg(config);
+
+    if (_DebugLevel) {
+      std::cout << "SbtMakeTracks c'tor : _fittingAlg BentCrystal = " << _fittingAlg->getAlgName() << std::endl;
+    }
+  }
+  else {
+    std::cout << "Invalid fitting algorithm specified: " << fittingAlg << std::endl;
+    assert(false);
+  }
+}
+
+SbtPatRecAlg* SbtMakeTracks::newPatRecAlg(const std::string& name, const YAML::Node& config) {
+  SbtPatRecAlg* patRecAlg = nullptr;
+  if (name == "Simple") {
+    patRecAlg = new SbtSimplePatRecAlg(config, _trackDetID);
+    if (_DebugLevel) {
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
            << std::endl;
-      std::cout << "SbtMakeTracks c'tor : roadWidth = " << _patRecAlg->getRoadWidth()
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
            << std::endl;
     }
   }
-  else if (patRecAlg == "Recursive") {
-    _patRecAlg = new SbtRecursivePatRecAlg(config, _trackDetID);
+  else if (name == "Fixed") {
+    // unrolled Recursive pattern recognition, for the common plane counts
+    switch (_trackDetID.size()) {
+      case 4: patRecAlg = new SbtFixedPatRecAlg<4>(config, _trackDetID); break;
+      case 6: patRecAlg = new SbtFixedPatRecAlg<6>(config, _trackDetID); break;
+      case 8: patRecAlg = new SbtFixedPatRecAlg<8>(config, _trackDetID); break;
+      default:
+        std::cout << "SbtMakeTracks: no Fixed pattern recognition for " << _trackDetID.size()
+                  << " planes, using Recursive" << std::endl;
+        patRecAlg = new SbtRecursivePatRecAlg(config, _trackDetID);
+    }
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << _patRecAlg->getAlgName()
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
            << std::endl;
-      std::cout << "SbtMakeTracks c'tor : roadWidth = " << _patRecAlg->getRoadWidth()
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
            << std::endl;
     }
   }
-  else if (patRecAlg == "SingleSide") {
-    _patRecAlg = new SbtSingleSidePatRecAlg(config, _trackDetID);
+  else if (name == "Recursive") {
+    patRecAlg = new SbtRecursivePatRecAlg(config, _trackDetID);
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << _patRecAlg->getAlgName()
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
            << std::endl;
-      std::cout << "SbtMakeTracks c'tor : roadWidth = " << _patRecAlg->getRoadWidth()
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
            << std::endl;
     }
   }
-  else if (patRecAlg == "Constrained") {
-    _patRecAlg = new SbtConstrainedPatRecAlg(config, _trackDetID);
+  else if (name == "SingleSide") {
+    patRecAlg = new SbtSingleSidePatRecAlg(config, _trackDetID);
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << _patRecAlg->getAlgName()
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
            << std::endl;
-      std::cout << "SbtMakeTracks c'tor : roadWidth = " << _patRecAlg->getRoadWidth()
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
            << std::endl;
     }
   }
-  else if (patRecAlg == "BentCrystal") {
-    _patRecAlg = new SbtBentCrystalPatRecAlg(config, _trackDetID);
+  else if (name == "Constrained") {
+    patRecAlg = new SbtConstrainedPatRecAlg(config, _trackDetID);
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << _patRecAlg->getAlgName()
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
            << std::endl;
-      std::cout << "SbtMakeTracks c'tor : roadWidth = " << _patRecAlg->getRoadWidth()
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
            << std::endl;
     }
   }
-  else {
-    std::cout << "Invalid pattern recognition algorithm specified: " << patRecAlg << std::endl;
-    assert(false);
+  else if (name == "BentCrystal") {
+    patRecAlg = new SbtBentCrystalPatRecAlg(config, _trackDetID);
+    if (_DebugLevel) {
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
+           << std::endl;
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
+           << std::endl;
+    }
   }
-
-  if (fittingAlg == "Simple") {
-    _fittingAlg = new SbtSimpleFittingAlg();
-
+  else if (name == "CKF") {
+    patRecAlg = new SbtCKFPatRecAlg(config, _trackDetID);
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _fittingAlg Simple = " << _fittingAlg->getAlgName() << std::endl;
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
+           << std::endl;
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
+           << std::endl;
     }
-  } 
-  else if (fittingAlg == "Simple3D") {
-    _fittingAlg = new SbtSimple3DFittingAlg();
-
+  }
+  else if (name == "Hough") {
+    patRecAlg = new SbtHoughPatRecAlg(config, _trackDetID);
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _fittingAlg Simple3D = " << _fittingAlg->getAlgName() << std::endl;
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
+           << std::endl;
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
+           << std::endl;
     }
   }
-  else if (fittingAlg == "BentCrystal") {
-    _fittingAlg = new SbtBentCrystalFittingAlg(config);
-
+  else if (name == "CellularAutomaton") {
+    patRecAlg = new SbtCellularAutomatonPatRecAlg(config, _trackDetID);
     if (_DebugLevel) {
-      std::cout << "SbtMakeTracks c'tor : _fittingAlg BentCrystal = " << _fittingAlg->getAlgName() << std::endl;
+      std::cout << "SbtMakeTracks c'tor : _patRecAlg = " << patRecAlg->getAlgName()
+           << std::endl;
+      std::cout << "SbtMakeTracks c'tor : roadWidth = " << patRecAlg->getRoadWidth()
+           << std::endl;
     }
   }
   else {
-    std::cout << "Invalid fitting algorithm specified: " << fittingAlg << std::endl;
+    std::cout << "Invalid pattern recognition algorithm specified: " << name << std::endl;
     assert(false);
   }
+  return patRecAlg;
 }
 
 void SbtMakeTracks::makeTracks(SbtEvent* event) {
@@ -119,18 +200,52 @@ void SbtMakeTracks::makeTracks(SbtEvent* event) {
   }
 
   int ntracks = _patRecAlg->linkHits(event);
+  if (_patRecAlg->budgetExceeded()) {
+    // the partial candidates are dropped and the event is tracked again
+    // with the fallback algorithm, if there is one; it is flagged as not
+    // trackable only if it is skipped
+    if (_DebugLevel) {
+      std::cout << "SbtMakeTracks: event over the pattern recognition budget" << std::endl;
+    }
+    _nOverBudget++;
+    clearTracks(event);
+    ntracks = 0;
+    if (_fallbackPatRecAlg) ntracks = _fallbackPatRecAlg->linkHits(event);
+    if (_fallbackPatRecAlg && !_fallbackPatRecAlg->budgetExceeded()) {
+      _nFallback++;
+    }
+    else {
+      event->SetTrackable(false);
+      clearTracks(event);
+      ntracks = 0;
+      _nSkipped++;
+    }
+  }
 
   if (_DebugLevel) {
     std::cout << "patRecList size =  " << ntracks << std::endl;
   }
+  if (_maxSharedSpacePoints >= 0 && event->GetTrackList().size() > 1) {
+    int nDropped = resolveAmbiguities(event);
+    if (_DebugLevel) {
+      std::cout << "candidates dropped by ambiguity resolution = " << nDropped << std::endl;
+    }
+  }
   for (auto& track : event->GetTrackList()) {
     // Add the fitted track to the final Track list of the event
     if (_DebugLevel > 2) {
       std::cout << "SbtMakeTracks:_fittingAlg->getAlgName() = " << _fittingAlg->getAlgName() << std::endl;
     }
     track.SortSpacePoints();
-    _fittingAlg->fitTrack(track);
+    bool fitted = _fittingAlg->fitTrack(track);
     if (_DebugLevel > 1) track.Print();
+    // the seed slope window is learned from the accepted straight tracks
+    // only, not from the ghosts and the channelled segments
+    if (fitted && (track.GetShape() == SbtEnums::trackShape::undefinedTrackShape ||
+                   track.GetShape() == SbtEnums::trackShape::longTrack)) {
+      _patRecAlg->learnSeedSlope(track.GetBx(), track.GetBy());
+      if (_fallbackPatRecAlg) _fallbackPatRecAlg->learnSeedSlope(track.GetBx(), track.GetBy());
+    }
   }
 
   if (_DebugLevel > 2) {
@@ -138,7 +253,124 @@ void SbtMakeTracks::makeTracks(SbtEvent* event) {
   }
 }
 
+void SbtMakeTracks::overrideRoadWidth(double roadWidth) {
+  _patRecAlg->overrideRoadWidth(roadWidth);
+  if (_fallbackPatRecAlg) _fallbackPatRecAlg->overrideRoadWidth(roadWidth);
+}
+
 SbtMakeTracks::~SbtMakeTracks() {
+  if (_nOverBudget) {
+    std::cout << "SbtMakeTracks: " << _nOverBudget << " events over the pattern recognition budget, "
+              << _nFallback << " tracked with the fallback algorithm, " << _nSkipped << " skipped" << std::endl;
+  }
   delete _patRecAlg;
+  delete _fallbackPatRecAlg;
   delete _fittingAlg;
 }
+
+void SbtMakeTracks::clearTracks(SbtEvent* event) {
+  event->GetTrackList().clear();
+  resetOnTrack(event);
+}
+
+void SbtMakeTracks::resetOnTrack(SbtEvent* event) {
+  for (auto& sp : event->GetSpacePointList()) {
+    sp.SetIsOnTrack(false);
+  }
+  for (auto& hit : event->GetHitList()) {
+    hit.SetIsOnTrack(false);
+  }
+  for (auto& cluster : event->GetStripClusterList()) {
+    cluster.SetIsOnTrack(false);
+  }
+  for (auto& cluster : event->GetPxlClusterList()) {
+    cluster.SetIsOnTrack(false);
+  }
+  for (auto& digi : event->GetStripDigiList()) {
+    digi.SetIsOnTrack(false);
+  }
+  for (auto& digi : event->GetPxlDigiList()) {
+    digi.SetIsOnTrack(false);
+  }
+}
+
+//
+// The candidates are ranked by their number of space points, then by the
+// sum of the squared distances of their inner space points from the line
+// through the outer ones, then by the squared slope of that line, so that
+// of two candidates without inner space points the one closer to the beam
+// axis comes first. The remaining ties, e.g. candidates that only differ by
+// their inner space points at equal distances, are broken on the indices of
+// the space points in the event, so the ranking does not depend on the
+// order in which the pattern recognition found the candidates. The
+// candidates are accepted in this order if they share at most
+// _maxSharedSpacePoints space points with the candidates already accepted.
+// The accepted candidates keep their order in the track list.
+//
+int SbtMakeTracks::resolveAmbiguities(SbtEvent* event) {
+  std::vector<SbtTrack>& trackList = event->GetTrackList();
+  std::vector<SbtSpacePoint>& spList = event->GetSpacePointList();
+  int nTracks = trackList.size();
+
+  _candidateQuality.resize(nTracks);
+  _candidateSpacePoints.resize(nTracks);
+  _candidateRank.resize(nTracks);
+  for (int i = 0; i < nTracks; i++) {
+    std::vector<SbtSpacePoint*> trkSP = trackList[i].GetSpacePointList();
+    std::sort(trkSP.begin(), trkSP.end(), SbtSpacePoint::ltz_ptr);
+    double quality = 0, slope2 = 0;
+    if (trkSP.size() > 1) {
+      TVector3 d = trkSP.back()->point() - trkSP.front()->point();
+      if (d.Z() != 0) slope2 = (d.X() * d.X() + d.Y() * d.Y()) / (d.Z() * d.Z());
+    }
+    if (trkSP.size() > 2) {
+      SbtLineSegment line(trkSP.front()->point(), trkSP.back()->point());
+      for (unsigned int k = 1; k + 1 < trkSP.size(); k++) {
+        double d = line.distance(trkSP[k]->point());
+        quality += d * d;
+      }
+    }
+    _candidateQuality[i] = std::make_tuple(-int(trkSP.size()), quality, slope2);
+    _candidateSpacePoints[i].clear();
+    for (auto sp : trkSP) _candidateSpacePoints[i].push_back(sp - spList.data());
+    _candidateRank[i] = i;
+  }
+  std::sort(_candidateRank.begin(), _candidateRank.end(), [this](int a, int b) {
+    if (_candidateQuality[a] != _candidateQuality[b]) return _candidateQuality[a] < _candidateQuality[b];
+    return _candidateSpacePoints[a] < _candidateSpacePoints[b];
+  });
+
+  _spacePointUsed.assign(spList.size() / 64 + 1, 0);
+  std::vector<bool> accepted(nTracks, false);
+  int nAccepted = 0;
+  for (int i : _candidateRank) {
+    const std::vector<SbtSpacePoint*>& trkSP = trackList[i].GetSpacePointList();
+    int nShared = 0;
+    for (auto sp : trkSP) {
+      unsigned int idx = sp - spList.data();
+      nShared += (_spacePointUsed[idx / 64] >> (idx % 64)) & 1;
+    }
+    if (nShared > _maxSharedSpacePoints) continue;
+    for (auto sp : trkSP) {
+      unsigned int idx = sp - spList.data();
+      _spacePointUsed[idx / 64] |= uint64_t(1) << (idx % 64);
+    }
+    accepted[i] = true;
+    nAccepted++;
+  }
+  if (nAccepted == nTracks) return 0;
+
+  std::vector<SbtTrack> keptTracks;
+  keptTracks.reserve(nAccepted);
+  for (int i = 0; i < nTracks; i++) {
+    if (accepted[i]) keptTracks.push_back(trackList[i]);
+  }
+  trackList.swap(keptTracks);
+
+  // the dropped candidates flagged their space points as on track
+  resetOnTrack(event);
+  for (auto& track : trackList) {
+    track.SetIsOnTrack();
+  }
+  return nTracks - nAccepted;
+}
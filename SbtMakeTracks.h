@@ -1,8 +1,10 @@
 #ifndef SBT_MAKETRACKS
 #define SBT_MAKETRACKS
 
-#include <vector>
+#include <cstdint>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <yaml-cpp/yaml.h>
 
@@ -18,15 +20,49 @@ class SbtMakeTracks {
   virtual ~SbtMakeTracks();
 
   SbtPatRecAlg* getPatRecAlg() { return _patRecAlg; }
+  SbtPatRecAlg* getFallbackPatRecAlg() { return _fallbackPatRecAlg; }
   SbtFittingAlg* getFittingAlg() { return _fittingAlg; }
   void setDebugLevel(int debugLevel) { _DebugLevel = debugLevel; }
   int getDebugLevel() const { return _DebugLevel; }
 
   void makeTracks(SbtEvent* event);
 
+  // road width of the pattern recognition and of the fallback algorithm
+  void overrideRoadWidth(double roadWidth);
+
+  // candidates sharing more than maxShared space points with a better
+  // candidate are dropped before the fit; a negative value disables it
+  void setMaxSharedSpacePoints(int maxShared) { _maxSharedSpacePoints = maxShared; }
+  int getMaxSharedSpacePoints() const { return _maxSharedSpacePoints; }
+
+  // events over the pattern recognition budget: all of them, those tracked
+  // with the fallback algorithm and those left without tracks
+  int getNOverBudget() const { return _nOverBudget; }
+  int getNFallback() const { return _nFallback; }
+  int getNSkipped() const { return _nSkipped; }
+
  protected:
+  // keep the best candidates with at most _maxSharedSpacePoints shared
+  // space points; returns the number of dropped candidates
+  int resolveAmbiguities(SbtEvent* event);
+  SbtPatRecAlg* newPatRecAlg(const std::string& name, const YAML::Node& config);
+  // remove the tracks of the event and reset the on-track flags
+  void clearTracks(SbtEvent* event);
+  void resetOnTrack(SbtEvent* event);
+
   int _DebugLevel;
+  int _maxSharedSpacePoints;
+  int _nOverBudget;
+  int _nFallback;
+  int _nSkipped;
+
+  // work arrays of the ambiguity resolution
+  std::vector<std::tuple<int, double, double> > _candidateQuality;
+  std::vector<std::vector<int> > _candidateSpacePoints;
+  std::vector<int> _candidateRank;
+  std::vector<uint64_t> _spacePointUsed;  // one bit per event space point
   SbtPatRecAlg* _patRecAlg;
+  SbtPatRecAlg* _fallbackPatRecAlg;  // used for the events over budget, may be null
   SbtFittingAlg* _fittingAlg;
   std::vector<int> _trackDetID;
 
@@ -15,6 +15,9 @@ class SbtMultipleScattering {
 
   virtual void MultipleScattering(TVector3& point, TVector3& direction, double RadLen) = 0;
 
+  // sigma of MS angle distribution (energy in MeV)
+  static double MultipleScatteringAngleSigma(double energy, double thickness, double radLen);
+
  protected:
   int _debugLevel;
 
@@ -26,9 +29,6 @@ class SbtMultipleScattering {
   TRandom* getRandomGen() { return _genAlg->_aRandomFnc; }
   double getEnergy() { return _genAlg->_energy; }
 
-  // sigma of MS angle distribution
-  static double MultipleScatteringAngleSigma(double energy, double thickness, double radLen);
-
   ClassDef(SbtMultipleScattering, 0);
 };
 #endif
@@ -343,7 +343,8 @@ void SbtNtupleDumper::loadRecoEvent(const SbtEvent* event) {
   _bco = event->GetBCOCounter();
   _trigger_type = event->Gettrigger_type();
 
-  _ncluster = event->GetPxlClusterList().size() + event->GetStripClusterList().size();
+  _ncluster = event->GetPxlClusterList().size() + event->GetStripClusterList().size() +
+              event->GetDutPxlClusterList().size() + event->GetDutStripClusterList().size();
   _ndigi = event->GetPxlDigiList().size() + event->GetStripDigiList().size();
   _ntrk = event->GetTrackList().size();
 
@@ -561,7 +562,12 @@ UShort_t SbtNtupleDumper::getSpacePointInfo(const SbtEvent* event) {
   if (_debugLevel) std::cout << "SbtNtupleDumper::GetSpacePointInfo" << std::endl;
   // loop on the space point objects
   UShort_t IdxSP = 0;
-  for (const auto& sp : event->GetSpacePointList()) {
+  // the space points of the DUT planes of the ROI mode come after the others
+  std::vector<const SbtSpacePoint*> spList;
+  for (const auto& sp : event->GetSpacePointList()) spList.push_back(&sp);
+  for (const auto& sp : event->GetDutSpacePointList()) spList.push_back(&sp);
+  for (auto spPtr : spList) {
+    const SbtSpacePoint& sp = *spPtr;
     assert(IdxSP < maxEvtNSpacePoint);
 
     if (!sp.GetDetectorElem()) continue;
@@ -610,53 +616,67 @@ UShort_t SbtNtupleDumper::getSpacePointInfo(const SbtEvent* event) {
 void SbtNtupleDumper::getIntersectionInfo(const SbtEvent* event) {
   if (_debugLevel) std::cout << "SbtNtupleDumper::GetIntersectionInfo" << std::endl;
 
-  // loop over tracks
-
-  int intIdx = 0;
-
+  // fitted tracks
+  std::vector<unsigned int> trackIdx;
   for (unsigned int itk = 0; itk < event->GetTrackList().size(); itk++) {
     if (event->GetTrackList().at(itk).GetFitStatus() <= 0) continue;
-    // loop over layers
-    for (unsigned int idet = 0; idet < _nDet; idet++) {
-      SbtDetectorElem* detElem = _config->getDetectorElemFromID(idet);
-
-      if (_debugLevel > 0) {
-        std::cout << "SbtNtupleDumper::GetIntersectionInfo" << std::endl;
-        std::cout << "DetElemID = " << detElem->GetID() << std::endl;
-        std::cout << "X position =  " << detElem->GetXPos() << std::endl;
-        std::cout << "Y position =  " << detElem->GetYPos() << std::endl;
-        std::cout << "Z position =  " << detElem->GetZPos() << std::endl;
-      }
+    trackIdx.push_back(itk);
+  }
+  int nTrk = trackIdx.size();
 
-      // get intersection point (in global) coordinates
-      TVector3 intPoint;
-      bool ok = event->GetTrackList().at(itk).IntersectPlane(detElem, intPoint);
+  int nIntersect = nTrk * _nDet;
+  if (nIntersect >= maxIntersects) {
+    std::cout << "SbtNtupleDumper: maxIntersects exceeded: " << nIntersect << std::endl;
+    assert(nIntersect < maxIntersects);
+  }
+  _nIntersect = nIntersect;
 
-      // get local version
-      TVector3 intPointLocal;
+  // intersections of all the tracks with one layer, in global and local coordinates
+  std::vector<double> x(nTrk), y(nTrk), z(nTrk);
+  std::vector<double> u(nTrk), v(nTrk), w(nTrk);
+  std::vector<bool> inside(nTrk);
 
-      detElem->MasterToLocal(intPoint, intPointLocal);
+  // loop over layers
+  for (unsigned int idet = 0; idet < _nDet; idet++) {
+    SbtDetectorElem* detElem = _config->getDetectorElemFromID(idet);
 
-      _intTrkID[intIdx] = itk;
-      _intLayer[intIdx] = detElem->GetID();
-      _intInside[intIdx] = (ok) ? 1 : 0;
-      _intLayerType[intIdx] = detElem->GetDetectorType()->GetIntType();
+    if (_debugLevel > 0) {
+      std::cout << "SbtNtupleDumper::GetIntersectionInfo" << std::endl;
+      std::cout << "DetElemID = " << detElem->GetID() << std::endl;
+      std::cout << "X position =  " << detElem->GetXPos() << std::endl;
+      std::cout << "Y position =  " << detElem->GetYPos() << std::endl;
+      std::cout << "Z position =  " << detElem->GetZPos() << std::endl;
+    }
 
-      _intXPos[intIdx] = intPoint[0];
-      _intYPos[intIdx] = intPoint[1];
-      _intZPos[intIdx] = intPoint[2];
+    // get intersection points (in global) coordinates
+    for (int iTrk = 0; iTrk < nTrk; iTrk++) {
+      TVector3 intPoint;
+      inside[iTrk] = event->GetTrackList().at(trackIdx[iTrk]).IntersectPlane(detElem, intPoint);
+      x[iTrk] = intPoint[0];
+      y[iTrk] = intPoint[1];
+      z[iTrk] = intPoint[2];
+    }
 
-      _intUPos[intIdx] = intPointLocal[0];
-      _intVPos[intIdx] = intPointLocal[1];
-      intIdx++;
+    // get local version, for all the tracks at once
+    detElem->MasterToLocal(nTrk, x.data(), y.data(), z.data(), u.data(), v.data(), w.data());
 
-      if (intIdx >= maxIntersects) {
-        std::cout << "SbtNtupleDumper: maxIntersects exceeded: " << intIdx << std::endl;
-        assert(intIdx < maxIntersects);
-      }
+    int layerType = detElem->GetDetectorType()->GetIntType();
+    for (int iTrk = 0; iTrk < nTrk; iTrk++) {
+      // intersections are stored track by track
+      int intIdx = iTrk * _nDet + idet;
+      _intTrkID[intIdx] = trackIdx[iTrk];
+      _intLayer[intIdx] = detElem->GetID();
+      _intInside[intIdx] = (inside[iTrk]) ? 1 : 0;
+      _intLayerType[intIdx] = layerType;
+
+      _intXPos[intIdx] = x[iTrk];
+      _intYPos[intIdx] = y[iTrk];
+      _intZPos[intIdx] = z[iTrk];
+
+      _intUPos[intIdx] = u[iTrk];
+      _intVPos[intIdx] = v[iTrk];
     }
   }
-  _nIntersect = intIdx;
 }
 
 void SbtNtupleDumper::loadMCevent(const SbtEvent* event) {
@@ -1,13 +1,34 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <iostream>
 
 #include "SbtPatRecAlg.h"
 #include "SbtDetectorElem.h"
+#include "SbtDetectorType.h"
+#include "SbtEvent.h"
+#include "SbtLineSegment.h"
+#include "SbtMultipleScattering.h"
+#include "SbtWorkerPool.h"
 
 ClassImp(SbtPatRecAlg)
 
 SbtPatRecAlg::SbtPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID) : 
   _DebugLevel(0),
   _roadWidth(0),
+  _scatteringRoadWidth(false),
+  _scatteringBeamEnergy(0),
+  _intrinsicResolution(0),
+  _roadWidthScale(3),
+  _nThreads(1),
+  _workerPool(nullptr),
+  _maxCombinations(0),
+  _maxTime(0),
+  _budgetExceeded(false),
+  _useSlopeWindow(false),
+  _slopeNSigma(3),
+  _learnSlopeTracks(0),
+  _nBackSeeds(0),
   _currentEvent(nullptr),
   _trackDetID(trackDetID),
   _nTrackDet(trackDetID.size()) {
@@ -15,22 +36,264 @@ SbtPatRecAlg::SbtPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID
   if (config["roadWidth"]) {
     _roadWidth = config["roadWidth"].as<double>();
   }
+  if (config["roadWidthFromScattering"] && config["roadWidthFromScattering"].as<bool>()) {
+    _scatteringRoadWidth = true;
+    _scatteringBeamEnergy = config["beamEnergy"] ? config["beamEnergy"].as<double>() : 0.;
+    _intrinsicResolution = config["intrinsicResolution"] ? config["intrinsicResolution"].as<double>() : 0.;
+    _roadWidthScale = config["roadWidthScale"] ? config["roadWidthScale"].as<double>() : 3.;
+    if (_scatteringBeamEnergy <= 0 || _roadWidthScale <= 0) {
+      std::cout << "SbtPatRecAlg: roadWidthFromScattering needs beamEnergy and a positive roadWidthScale"
+                << std::endl;
+      assert(0);
+    }
+  }
+  if (config["patRecThreads"]) {
+    _nThreads = config["patRecThreads"].as<int>();
+    assert(_nThreads >= 1);
+    if (_nThreads > 1) {
+      _workerPool = new SbtWorkerPool(_nThreads);
+      _seedBuffers.resize(_nThreads);
+      _bufferSeeds.resize(_nThreads);
+    }
+  }
+  setBudget(config["maxCombinations"] ? config["maxCombinations"].as<double>() : 0.,
+            config["maxPatRecTime"] ? config["maxPatRecTime"].as<double>() : 0.);
+
+  // beam slope window, given or learned from the first tracks
+  _slopeNSigma = config["beamSlopeNSigma"] ? config["beamSlopeNSigma"].as<double>() : 3.;
+  if (config["beamSlopeSigma"]) {
+    std::vector<double> mean = config["beamSlopeMean"] ? config["beamSlopeMean"].as<std::vector<double> >()
+                                                       : std::vector<double>(2, 0.);
+    std::vector<double> sigma = config["beamSlopeSigma"].as<std::vector<double> >();
+    assert(mean.size() == 2 && sigma.size() == 2);
+    setSeedSlopeWindow(mean[0], sigma[0], mean[1], sigma[1], _slopeNSigma);
+  }
+  else if (config["learnBeamSlope"]) {
+    _learnSlopeTracks = config["learnBeamSlope"].as<int>();
+  }
 }
 
-SbtPatRecAlg::SbtPatRecAlg() : _DebugLevel(0), _roadWidth(0),_currentEvent(nullptr) {
+SbtPatRecAlg::SbtPatRecAlg() : _DebugLevel(0), _roadWidth(0), _scatteringRoadWidth(false), _scatteringBeamEnergy(0),
+                               _intrinsicResolution(0), _roadWidthScale(3), _nThreads(1), _workerPool(nullptr),
+                               _maxCombinations(0), _maxTime(0),
+                               _budgetExceeded(false), _useSlopeWindow(false), _slopeNSigma(3),
+                               _learnSlopeTracks(0), _nBackSeeds(0), _currentEvent(nullptr) {
   std::cout << "SbtPatRecAlg:  DebugLevel= " << _DebugLevel << std::endl;
 }
 
+SbtPatRecAlg::~SbtPatRecAlg() {
+  delete _workerPool;
+}
+
 void SbtPatRecAlg::overrideRoadWidth(double roadWidth) {
   std::cout << "Overriding pat recognition algorithm road width. Old value = " << _roadWidth << ". New value = " << roadWidth << std::endl;
+  // the per-plane road widths are scaled by the same factor
+  if (_roadWidth > 0) {
+    _roadWidthScale *= roadWidth / _roadWidth;
+    for (auto& width : _planeRoadWidth) width *= roadWidth / _roadWidth;
+  }
   _roadWidth = roadWidth;
 }
 
+void SbtPatRecAlg::setBudget(double maxCombinations, double maxTime) {
+  if (maxCombinations < 0 || maxTime < 0) {
+    std::cout << "SbtPatRecAlg::setBudget: invalid budget " << maxCombinations << ", " << maxTime << std::endl;
+    assert(0);
+  }
+  _maxCombinations = maxCombinations;
+  _maxTime = maxTime;
+}
+
+void SbtPatRecAlg::setSeedSlopeWindow(double meanX, double sigmaX, double meanY, double sigmaY, double nSigma) {
+  if (sigmaX <= 0 || sigmaY <= 0 || nSigma <= 0) {
+    std::cout << "SbtPatRecAlg::setSeedSlopeWindow: invalid window " << sigmaX << ", " << sigmaY << ", "
+              << nSigma << std::endl;
+    assert(0);
+  }
+  _slopeMean[0] = meanX;
+  _slopeMean[1] = meanY;
+  _slopeSigma[0] = sigmaX;
+  _slopeSigma[1] = sigmaY;
+  _slopeNSigma = nSigma;
+  _useSlopeWindow = true;
+  std::cout << "SbtPatRecAlg: seed slope window x = " << meanX << " +- " << nSigma << " * " << sigmaX
+            << ", y = " << meanY << " +- " << nSigma << " * " << sigmaY << std::endl;
+}
+
 int SbtPatRecAlg::linkHits(SbtEvent* event) {
   _currentEvent = event;
+  _budgetExceeded = false;
+
+  if (_maxCombinations > 0) {
+    // upper limit of the candidates of an exhaustive search
+    int nSpacePoints[maxNTelescopeDetector] = {0};
+    for (auto& sp : event->GetSpacePointList()) {
+      if (sp.GetSpacePointType() != SbtEnums::objectType::reconstructed) continue;
+      nSpacePoints[sp.GetDetectorElem()->GetID()]++;
+    }
+    double nCombinations = 1;
+    for (auto detID : _trackDetID) nCombinations *= nSpacePoints[detID];
+    if (nCombinations > _maxCombinations) {
+      if (getDebugLevel()) {
+        std::cout << "SbtPatRecAlg: " << nCombinations << " combinations, event over budget" << std::endl;
+      }
+      _budgetExceeded = true;
+      return 0;
+    }
+  }
+
+  if ((int)_roadMasks.size() < _nThreads * maxNTelescopeDetector) {
+    _roadMasks.resize(_nThreads * maxNTelescopeDetector);
+  }
+  if (_maxTime > 0) {
+    _deadline = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(_maxTime));
+  }
   return _linkHits();
 }
 
+// the window is the mean and the RMS of the slopes of the first
+// _learnSlopeTracks fitted tracks
+void SbtPatRecAlg::learnSeedSlope(double slopeX, double slopeY) {
+  if (!learnsSeedSlopes()) return;
+  _learnedSlopes[0].push_back(slopeX);
+  _learnedSlopes[1].push_back(slopeY);
+  if ((int)_learnedSlopes[0].size() < _learnSlopeTracks) return;
+
+  double mean[2], sigma[2];
+  for (int p = 0; p < 2; p++) {
+    double sum = 0, sum2 = 0;
+    for (double slope : _learnedSlopes[p]) {
+      sum += slope;
+      sum2 += slope * slope;
+    }
+    int n = _learnedSlopes[p].size();
+    mean[p] = sum / n;
+    sigma[p] = sqrt(std::max(sum2 / n - mean[p] * mean[p], 0.));
+    _learnedSlopes[p].clear();
+  }
+  if (sigma[0] <= 0 || sigma[1] <= 0) {
+    std::cout << "SbtPatRecAlg: no spread in the learned slopes, no seed slope window" << std::endl;
+    _learnSlopeTracks = 0;
+    return;
+  }
+  setSeedSlopeWindow(mean[0], sigma[0], mean[1], sigma[1], _slopeNSigma);
+}
+
+// the distance of the space point on plane k from the line through the
+// points on the first and last planes has, in each projection, variance
+//   sigma_k^2 + (1 - t)^2 sigma_0^2 + t^2 sigma_N^2
+//   + sum_j theta_j^2 ((z_k - z_j)_+ - t (z_N - z_j))^2,
+// with t = (z_k - z_0) / (z_N - z_0) and theta_j the Highland angle of the
+// inner plane j. Only the material of the planes is taken into account.
+void SbtPatRecAlg::initializeRoadWidths() {
+  int n = _nTrackDet;
+  std::vector<double> z(n), res2(n), theta2(n);
+  for (int k = 0; k < n; k++) {
+    const SbtDetectorElem* detElem = _detSpacePointList[_trackDetID[k]].front()->GetDetectorElem();
+    SbtDetectorType* detType = detElem->GetDetectorType();
+    z[k] = detElem->GetZPos();
+    double res = _intrinsicResolution;
+    if (res <= 0) res = std::max(detType->GetUpitch(), detType->GetVpitch()) / sqrt(12.);
+    res2[k] = res * res;
+    double thickness = 2 * detType->GetZ_HalfDim();
+    double radLen = detElem->GetRadLen();
+    theta2[k] = 0;
+    if (radLen > 0 && thickness > 0) {
+      double theta = SbtMultipleScattering::MultipleScatteringAngleSigma(_scatteringBeamEnergy, thickness, radLen);
+      theta2[k] = theta * theta;
+    }
+  }
+
+  double length = z[n - 1] - z[0];
+  assert(length != 0);
+  _planeRoadWidth.assign(n, _roadWidth);
+  for (int k = 1; k < n - 1; k++) {
+    double t = (z[k] - z[0]) / length;
+    double var = res2[k] + (1 - t) * (1 - t) * res2[0] + t * t * res2[n - 1];
+    for (int j = 1; j < n - 1; j++) {
+      double lever = (j < k ? z[k] - z[j] : 0) - t * (z[n - 1] - z[j]);
+      var += theta2[j] * lever * lever;
+    }
+    // both projections
+    _planeRoadWidth[k] = _roadWidthScale * sqrt(2 * var);
+  }
+
+  std::cout << "SbtPatRecAlg: road widths";
+  for (int k = 1; k < n - 1; k++) std::cout << " " << _planeRoadWidth[k];
+  std::cout << std::endl;
+}
+
+int SbtPatRecAlg::makeSeeds(int kFront, int kBack) {
+  int front = _trackDetID[kFront], back = _trackDetID[kBack];
+  int nFront = _spX[front].size();
+  _nBackSeeds = _spX[back].size();
+  if (!_useSlopeWindow) return nFront * _nBackSeeds;
+
+  // the space points of the last plane are ordered by x, and those in the
+  // x range of the window are found by binary search; the distance in z
+  // between the planes is taken at its extremes for tilted planes
+  _seeds.clear();
+  std::vector<std::pair<double, int> > backX(_nBackSeeds);
+  for (int j = 0; j < _nBackSeeds; j++) backX[j] = std::make_pair(_spX[back][j], j);
+  std::sort(backX.begin(), backX.end());
+  auto frontZ = std::minmax_element(_spZ[front].begin(), _spZ[front].end());
+  auto backZ = std::minmax_element(_spZ[back].begin(), _spZ[back].end());
+  double dzMin = *backZ.first - *frontZ.second;
+  double dzMax = *backZ.second - *frontZ.first;
+
+  double slopeMin[2], slopeMax[2];
+  for (int p = 0; p < 2; p++) {
+    slopeMin[p] = _slopeMean[p] - _slopeNSigma * _slopeSigma[p];
+    slopeMax[p] = _slopeMean[p] + _slopeNSigma * _slopeSigma[p];
+  }
+  std::vector<int> partners;
+  for (int i = 0; i < nFront; i++) {
+    double x0 = _spX[front][i];
+    double xMin = x0 + std::min(slopeMin[0] * dzMin, slopeMin[0] * dzMax);
+    double xMax = x0 + std::max(slopeMax[0] * dzMin, slopeMax[0] * dzMax);
+    partners.clear();
+    for (auto it = std::lower_bound(backX.begin(), backX.end(), std::make_pair(xMin, -1));
+         it != backX.end() && it->first <= xMax; ++it) {
+      int j = it->second;
+      double dz = _spZ[back][j] - _spZ[front][i];
+      if (dz <= 0) continue;
+      double slopeX = (_spX[back][j] - x0) / dz;
+      double slopeY = (_spY[back][j] - _spY[front][i]) / dz;
+      if (slopeX < slopeMin[0] || slopeX > slopeMax[0] || slopeY < slopeMin[1] || slopeY > slopeMax[1]) continue;
+      partners.push_back(j);
+    }
+    std::sort(partners.begin(), partners.end());
+    for (int j : partners) _seeds.push_back(std::make_pair(i, j));
+  }
+  if (getDebugLevel() > 1) {
+    std::cout << "SbtPatRecAlg::makeSeeds: " << _seeds.size() << " seeds out of " << nFront * _nBackSeeds
+              << std::endl;
+  }
+  return _seeds.size();
+}
+
+void SbtPatRecAlg::getSeed(int seed, int& iFront, int& iBack) const {
+  if (_useSlopeWindow) {
+    iFront = _seeds[seed].first;
+    iBack = _seeds[seed].second;
+  }
+  else {
+    iFront = seed / _nBackSeeds;
+    iBack = seed % _nBackSeeds;
+  }
+}
+
+bool SbtPatRecAlg::outOfTime() {
+  if (_maxTime > 0 && !_budgetExceeded && std::chrono::steady_clock::now() > _deadline) {
+    if (getDebugLevel()) {
+      std::cout << "SbtPatRecAlg: time budget used up, event over budget" << std::endl;
+    }
+    _budgetExceeded = true;
+  }
+  return _budgetExceeded;
+}
+
 int SbtPatRecAlg::FindTelescopeDet(std::vector<SbtSpacePoint>& SpList) {
   int AllTelescopeDetFound = 1;
   // find the detector Elem ID for telescope detectors
@@ -44,6 +307,20 @@ int SbtPatRecAlg::FindTelescopeDet(std::vector<SbtSpacePoint>& SpList) {
       AllTelescopeDetFound = 0;
   }
 
+  if (AllTelescopeDetFound && _scatteringRoadWidth && _planeRoadWidth.empty()) initializeRoadWidths();
+
+  for (int i = 0; i < maxNTelescopeDetector; i++) {
+    std::vector<SbtSpacePoint*>& spList = _detSpacePointList[i];
+    _spX[i].resize(spList.size());
+    _spY[i].resize(spList.size());
+    _spZ[i].resize(spList.size());
+    for (unsigned int j = 0; j < spList.size(); j++) {
+      _spX[i][j] = spList[j]->GetXPosition();
+      _spY[i][j] = spList[j]->GetYPosition();
+      _spZ[i][j] = spList[j]->GetZPosition();
+    }
+  }
+
   if (getDebugLevel() > 1) {
     for (unsigned int i = 0; i < _trackDetID.size(); i++) {
       std::cout << "SbtSimplePatRecAlg::FindTeleScopeDet:"
@@ -57,4 +334,64 @@ int SbtPatRecAlg::FindTelescopeDet(std::vector<SbtSpacePoint>& SpList) {
   }
 
   return AllTelescopeDetFound;
-}
\ No newline at end of file
+}
+
+uint64_t* SbtPatRecAlg::roadMask(int worker, int plane, int n) {
+  // called by the workers: each one only resizes its own buffers
+  std::vector<uint64_t>& mask = _roadMasks[worker * maxNTelescopeDetector + plane];
+  if ((int)mask.size() < SbtLineSegment::maskSize(n)) mask.resize(SbtLineSegment::maskSize(n));
+  return mask.data();
+}
+
+int SbtPatRecAlg::runSeeds(int nSeeds, const std::function<int(int, int, CandidateList&)>& findCandidates,
+                           CandidateList& candidates) {
+  if (!_workerPool || nSeeds <= 1) {
+    int sum = 0;
+    for (int seed = 0; seed < nSeeds && !outOfTime(); seed++) sum += findCandidates(seed, 0, candidates);
+    // the candidates of an event over budget are incomplete
+    if (_budgetExceeded) candidates.clear();
+    return sum;
+  }
+
+  // each worker records the seed of its candidates for the final merge.
+  // Only the first worker looks at the clock: when the time is up it
+  // stops the pool, which stops the others too
+  int nWorkers = _workerPool->getNWorkers();
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) {
+    _seedBuffers[iWorker].clear();
+    _bufferSeeds[iWorker].clear();
+  }
+  std::vector<int> sums(nWorkers, 0);
+  _workerPool->run(nSeeds, [&](int seed, int iWorker) {
+    if (iWorker == 0 && outOfTime()) {
+      _workerPool->stop();
+      return;
+    }
+    CandidateList& buffer = _seedBuffers[iWorker];
+    int nBefore = buffer.size();
+    sums[iWorker] += findCandidates(seed, iWorker, buffer);
+    _bufferSeeds[iWorker].resize(buffer.size(), seed);
+    if (getDebugLevel() > 2) {
+      std::cout << "SbtPatRecAlg::runSeeds: seed " << seed << " candidates " << buffer.size() - nBefore
+                << std::endl;
+    }
+  });
+  if (_budgetExceeded) return 0;
+
+  // merge: the seeds of each buffer are increasing, and a seed is handled
+  // by a single worker, so a stable sort by seed restores the serial order
+  std::vector<std::pair<int, int> > order;  // (worker, index)
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) {
+    for (unsigned int i = 0; i < _seedBuffers[iWorker].size(); i++) order.push_back(std::make_pair(iWorker, i));
+  }
+  std::stable_sort(order.begin(), order.end(), [&](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+    return _bufferSeeds[a.first][a.second] < _bufferSeeds[b.first][b.second];
+  });
+  for (auto& entry : order) {
+    candidates.push_back(std::move(_seedBuffers[entry.first][entry.second]));
+  }
+
+  int sum = 0;
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) sum += sums[iWorker];
+  return sum;
+}
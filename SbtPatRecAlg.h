@@ -1,6 +1,9 @@
 #ifndef SBTPATRECALG_HH
 #define SBTPATRECALG_HH
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "SbtSpacePoint.h"
@@ -11,33 +14,113 @@
 class SbtHit;
 class SbtTrack;
 class SbtEvent;
+class SbtWorkerPool;
 
 class SbtPatRecAlg {
  public:
   SbtPatRecAlg();
   SbtPatRecAlg(const YAML::Node& config, std::vector<int> trackDetID);
-  virtual ~SbtPatRecAlg() {;}
+  virtual ~SbtPatRecAlg();
   void setDebugLevel(int debugLevel) { _DebugLevel = debugLevel; }
   int getDebugLevel() const { return _DebugLevel; }
 
   int linkHits(SbtEvent* event);
 
   double getRoadWidth() const { return _roadWidth; }
+  // road width on tracking plane k (z order): from the multiple scattering
+  // and the resolution of the planes if requested, _roadWidth otherwise
+  double getRoadWidth(int k) const { return _planeRoadWidth.empty() ? _roadWidth : _planeRoadWidth[k]; }
   std::string getAlgName() const { return _algName; }
 
   void overrideRoadWidth(double roadWidth);
 
+  int getNThreads() const { return _nThreads; }
+
+  // per-event budget: an event is given up if the product of the space
+  // point multiplicities of the tracking planes is larger than
+  // maxCombinations, or if the search takes longer than maxTime seconds.
+  // Zero disables the limit.
+  void setBudget(double maxCombinations, double maxTime);
+  double getMaxCombinations() const { return _maxCombinations; }
+  double getMaxTime() const { return _maxTime; }
+  // true if the last linkHits call was given up
+  bool budgetExceeded() const { return _budgetExceeded; }
+
+  // beam slope window: the seeds whose slope is more than nSigma sigma
+  // away from the mean beam slope in either projection are not tried
+  void setSeedSlopeWindow(double meanX, double sigmaX, double meanY, double sigmaY, double nSigma);
+  bool useSeedSlopeWindow() const { return _useSlopeWindow; }
+  // the window is learned from the slopes of the first learnBeamSlope
+  // fitted tracks, given by the caller after the fit
+  bool learnsSeedSlopes() const { return _learnSlopeTracks > 0 && !_useSlopeWindow; }
+  void learnSeedSlope(double slopeX, double slopeY);
+
  protected:
   virtual int _linkHits() = 0;
   virtual int FindTelescopeDet(std::vector<SbtSpacePoint>& SpList) final;
 
+  // run findCandidates(seed, worker, candidates) for each seed in
+  // [0, nSeeds) on _nThreads workers. Each worker collects the space point
+  // lists of its candidates in its own buffer, and the buffers are merged
+  // in seed order, so the candidates come out as in a serial loop.
+  // Returns the sum of the values returned by findCandidates.
+  typedef std::vector<std::vector<SbtSpacePoint*> > CandidateList;
+  int runSeeds(int nSeeds, const std::function<int(int, int, CandidateList&)>& findCandidates,
+               CandidateList& candidates);
+  // true, and the event flagged as over budget, once the time budget of
+  // the event is used up
+  bool outOfTime();
+  // pairs of space points on the first and last tracking planes, or on
+  // the tracking planes kFront and kBack, used as seeds, in the order of a
+  // loop on the front then on the back plane; makeSeeds returns their
+  // number and getSeed their indices in _detSpacePointList
+  int makeSeeds() { return makeSeeds(0, _nTrackDet - 1); }
+  int makeSeeds(int kFront, int kBack);
+  void getSeed(int seed, int& iFront, int& iBack) const;
+  // per-plane road widths from the detector elements of the current event
+  void initializeRoadWidths();
+  // buffer of worker for the SbtLineSegment::pointsInRoad mask of n space
+  // points of a plane
+  uint64_t* roadMask(int worker, int plane, int n);
+
   int _DebugLevel;
   double _roadWidth;  // road width for the candidate track
+  // per-plane road widths: roadWidthScale times the expected distance of a
+  // space point from the line through the outer ones, from the Highland
+  // scattering in the inner planes and the intrinsic resolution
+  bool _scatteringRoadWidth;
+  double _scatteringBeamEnergy;  // MeV
+  double _intrinsicResolution;   // 0: pitch / sqrt(12) of each plane
+  double _roadWidthScale;
+  std::vector<double> _planeRoadWidth;
   std::string _algName;
+  int _nThreads;      // workers used by runSeeds
+  SbtWorkerPool* _workerPool;  //! started once if _nThreads > 1
+  // candidates of each worker and their seeds, merged by runSeeds
+  std::vector<CandidateList> _seedBuffers;  //!
+  std::vector<std::vector<int> > _bufferSeeds;  //!
+  double _maxCombinations;
+  double _maxTime;    // s
+  bool _budgetExceeded;
+  std::chrono::steady_clock::time_point _deadline;  //!
+  bool _useSlopeWindow;
+  double _slopeMean[2];
+  double _slopeSigma[2];
+  double _slopeNSigma;
+  int _learnSlopeTracks;  // tracks used to learn the slope window, 0 if it is not learned
+  std::vector<double> _learnedSlopes[2];  //!
+  std::vector<std::pair<int, int> > _seeds;  //! with the slope window only
+  int _nBackSeeds;  //! without the slope window
   SbtEvent* _currentEvent;
   std::vector<int> _trackDetID;
   int _nTrackDet;
   std::vector<SbtSpacePoint*> _detSpacePointList[maxNTelescopeDetector];
+  // coordinates of the space points of _detSpacePointList, filled by
+  // FindTelescopeDet
+  std::vector<double> _spX[maxNTelescopeDetector];  //!
+  std::vector<double> _spY[maxNTelescopeDetector];  //!
+  std::vector<double> _spZ[maxNTelescopeDetector];  //!
+  std::vector<std::vector<uint64_t> > _roadMasks;   //! by worker and plane
 
   ClassDef(SbtPatRecAlg, 0);
 };
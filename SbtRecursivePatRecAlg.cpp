@@ -58,74 +58,54 @@ int SbtRecursivePatRecAlg::_linkHits() {
 
   if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
 
+  // bin the inner planes, so that only the space points around the
+  // crossing point of each road are visited
+  for (unsigned int k = 1; k < _nTrackDet - 1; k++) {
+    _grid[k].fill(_detSpacePointList[_trackDetID[k]], _roadWidth);
+  }
+  _roadCandidates.resize(_nThreads * maxNTelescopeDetector);
+
   // create the candidate tracks with n SpacePoints
   // n = _nTrackDet, the number of tracking detectors
 
-  // define here the vector of SpacePoint iterators
-  std::vector<std::vector<SbtSpacePoint *>::iterator> SPIterator;
-  std::vector<SbtSpacePoint *>::iterator tmpIter;
+  // each pair of outer SpacePoints (first and last detector) is a seed: the
+  // seeds are searched in parallel and the tracks are built in seed order
+  // (only the pairs within the beam slope window, if there is one)
+  std::vector<SbtSpacePoint*>& spListFront = _detSpacePointList[_trackDetID[0]];
+  std::vector<SbtSpacePoint*>& spListBack = _detSpacePointList[_trackDetID[_nTrackDet - 1]];
+  CandidateList candidates;
+  _nRoadCandidates = runSeeds(makeSeeds(), [&](int seed, int worker, CandidateList& found) {
+    int iFront, iBack;
+    getSeed(seed, iFront, iBack);
+    // define here the vector of SpacePoint iterators
+    std::vector<std::vector<SbtSpacePoint*>::iterator> SPIterator(_nTrackDet);
+    SPIterator.front() = spListFront.begin() + iFront;
+    SPIterator.back() = spListBack.begin() + iBack;
+    // the road is fixed by the seed: the space points of all the inner
+    // planes in the road are found once, before the loops
+    int nRoadCandidates = 0;
+    if (!findRoadCandidates(*SPIterator.front(), *SPIterator.back(), worker, nRoadCandidates)) {
+      return nRoadCandidates;
+    }
+    // loop on inner telescope detector SpacePoints
+    LoopOnSpacePoints(SPIterator, 1, worker, found);
+    return nRoadCandidates;
+  }, candidates);
 
-  for (unsigned int i = 0; i < _nTrackDet; i++) {
-    SPIterator.push_back(tmpIter);
+  //  start to build the tracks using SpacePoints
+  for (auto& SPList : candidates) {
+    _currentEvent->AddTrack(SbtTrack(SPList));
+    _trkCounter++;
   }
 
-  // loop on outer telescope (first detector)  SpacePoints
-  for (SPIterator.front() = _detSpacePointList[_trackDetID[0]].begin();
-       SPIterator.front() != _detSpacePointList[_trackDetID[0]].end();
-       SPIterator.front()++) {
-    // loop on outer telescope (last detector)  SpacePoints
-    for (SPIterator.back() =
-             _detSpacePointList[_trackDetID[_nTrackDet - 1]].begin();
-         SPIterator.back() !=
-         _detSpacePointList[_trackDetID[_nTrackDet - 1]].end();
-         SPIterator.back()++) {
-      // loop on inner telescope detector SpacePoints
-      unsigned int k = 1;
-
-      LoopOnSpacePoints(SPIterator, k);
-
-    }  // close loop on outer detector, last one
-  }    // close loop on outer detector, first one
-
-  SPIterator.clear();
-
   if (getDebugLevel() > 1) {
     std::cout << "SbtRecursivePatRec: _trkCounter = " << _trkCounter << std::endl;
+    std::cout << "SbtRecursivePatRec: road candidates = " << _nRoadCandidates << std::endl;
   }
   return _trkCounter;
 }
 
-bool SbtRecursivePatRecAlg::isInsideTrkRoad(SbtSpacePoint *sp0,
-                                            SbtSpacePoint *sp3,
-                                            SbtSpacePoint *spInternal) {
-  bool passed = false;
-
-  TVector3 x0 = sp0->point();
-  TVector3 x3 = sp3->point();
-  TVector3 xInternal = spInternal->point();
-
-  SbtLineSegment line(x0, x3);
-  if (line.distance(xInternal) < _roadWidth) {
-    passed = true;
-  } else {
-    passed = false;
-  }
-  if (getDebugLevel() > 1) {
-    std::cout << "SbtRecursivePatRec: Distance xInternal = "
-         << line.distance(xInternal) << std::endl;
-    std::cout << "x0   = ";
-    x0.Print();
-    std::cout << "x3   = ";
-    x3.Print();
-    std::cout << "xInt = ";
-    xInternal.Print();
-    std::cout << "passed = " << passed << std::endl;
-  }
-
-  return passed;
-}
-
-bool SbtRecursivePatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpacePoint *>::iterator> SPIter) {
+bool SbtRecursivePatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpacePoint *>::iterator> SPIter) const {
   bool passed = false;
 
   if (getDebugLevel() > 1) {
@@ -173,7 +153,7 @@ bool SbtRecursivePatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpacePoi
   passed = true;
 
   for (unsigned int i = 1; i < (_nTrackDet - 1); i++) {
-    if (line.distance(x.at(i)) > _roadWidth) passed = false;
+    if (line.distance(x.at(i)) > getRoadWidth(i)) passed = false;
   }
 
   if (getDebugLevel() > 1) {
@@ -186,42 +166,59 @@ bool SbtRecursivePatRecAlg::isCandidateTrack(std::vector<std::vector<SbtSpacePoi
   return passed;
 }
 
-void SbtRecursivePatRecAlg::LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::iterator> &SPIter, unsigned int k) {
+bool SbtRecursivePatRecAlg::findRoadCandidates(const SbtSpacePoint* front, const SbtSpacePoint* back, int worker,
+                                               int& nRoadCandidates) {
+  SbtLineSegment line(front->point(), back->point());
+  for (unsigned int k = 1; k < _nTrackDet - 1; k++) {
+    int detID = _trackDetID[k];
+    std::vector<int>& candidates = _roadCandidates[worker * maxNTelescopeDetector + k];
+    _grid[k].findInRoad(front->point(), back->point(), getRoadWidth(k), candidates);
+    int nCandidates = candidates.size();
+    nRoadCandidates += nCandidates;
+    // a plane without space points near the road: no track from this seed
+    if (nCandidates == 0) return false;
+    line.pointsInRoad(nCandidates, candidates.data(), _spX[detID].data(), _spY[detID].data(),
+                      _spZ[detID].data(), getRoadWidth(k), roadMask(worker, k, nCandidates));
+  }
+  return true;
+}
+
+void SbtRecursivePatRecAlg::LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::iterator> &SPIter, unsigned int k,
+                                              int worker, CandidateList& found) {
   if (getDebugLevel() > 1) {
     std::cout << "SbtRecursivePatRecAlg::LoopOnSpacePoints nested loop n. " << k
          << std::endl;
   }
 
-  // loop on inner telescope detector SpacePoints
-
-  for (SPIter[k] = _detSpacePointList[_trackDetID[k]].begin();
-       SPIter[k] != _detSpacePointList[_trackDetID[k]].end(); SPIter[k]++) {
-    // check if the Internal SP is within the track nominal road
-    // pay attention: SP ordering matters below
+  // loop on the inner telescope detector SpacePoints in the road
+  std::vector<SbtSpacePoint*>& spList = _detSpacePointList[_trackDetID[k]];
+  const std::vector<int>& candidates = _roadCandidates[worker * maxNTelescopeDetector + k];
+  int nCandidates = candidates.size();
+  uint64_t* inRoad = roadMask(worker, k, nCandidates);
 
-    if (!isInsideTrkRoad(*SPIter.front(), *SPIter.back(), *SPIter[k])) continue;
+  for (int iCandidate = 0; iCandidate < nCandidates; iCandidate++) {
+    if (!SbtLineSegment::inMask(inRoad, iCandidate)) continue;
+    SPIter[k] = spList.begin() + candidates[iCandidate];
 
     if ((_nTrackDet - 2) == k) {
       bool isGoodTrack = isCandidateTrack(SPIter);
 
       if (isGoodTrack) {
-        //  start to build the tracks using SpacePoints
         std::vector<SbtSpacePoint*> SPList;
         for (unsigned int i = 0; i < _nTrackDet; i++) {
           SPList.push_back(*SPIter.at(i));
         }
-        _currentEvent->AddTrack(SbtTrack(SPList));
-        _trkCounter++;
+        found.push_back(SPList);
       }
     }
 
     if (k < (_nTrackDet - 2)) {
-      LoopOnSpacePoints(SPIter, k + 1);
+      LoopOnSpacePoints(SPIter, k + 1, worker, found);
     }
   }
 }
 
-void SbtRecursivePatRecAlg::SortSpacePoints(std::vector<SbtSpacePoint*> &SPList) {
+void SbtRecursivePatRecAlg::SortSpacePoints(std::vector<SbtSpacePoint*> &SPList) const {
   // try this
   sort(SPList.begin(), SPList.end(), SbtSpacePoint::ltz_ptr);
 }
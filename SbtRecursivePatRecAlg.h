@@ -5,6 +5,7 @@
 
 #include "SbtDef.h"
 #include "SbtPatRecAlg.h"
+#include "SbtSpacePointGrid.h"
 
 class SbtEvent;
 class SbtTrack;
@@ -18,12 +19,24 @@ class SbtRecursivePatRecAlg : public SbtPatRecAlg {
 
  protected:
   int _trkCounter;
+  int _nRoadCandidates;  // inner space points tested against a road
 
-  bool isCandidateTrack(std::vector<std::vector<SbtSpacePoint*>::iterator> SPIter);
-  bool isInsideTrkRoad(SbtSpacePoint* outerSpacePoint0, SbtSpacePoint* outerSpacePoint1, SbtSpacePoint* innerSpacePoint);
-  void SortSpacePoints(std::vector<SbtSpacePoint*>& SPList);
+  // space points of each tracking plane binned in (x, y) and the indices of
+  // the space points found in the current road, by worker and plane
+  SbtSpacePointGrid _grid[maxNTelescopeDetector];
+  std::vector<std::vector<int> > _roadCandidates;
+
+  bool isCandidateTrack(std::vector<std::vector<SbtSpacePoint*>::iterator> SPIter) const;
+  void SortSpacePoints(std::vector<SbtSpacePoint*>& SPList) const;
   void SortDetectorElems(std::vector<SbtDetectorElem*>& DEList);
-  void LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::iterator>& SPIter, unsigned int k);
+  // find the space points of the inner planes in the road of the seed, in
+  // _roadCandidates and in the road masks of the worker; adds the number of
+  // road candidates tested to nRoadCandidates and returns false if a plane
+  // has none
+  bool findRoadCandidates(const SbtSpacePoint* front, const SbtSpacePoint* back, int worker, int& nRoadCandidates);
+  // add the candidates of the road of SPIter to found
+  void LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::iterator>& SPIter, unsigned int k,
+                         int worker, CandidateList& found);
   int _linkHits();
 
   ClassDef(SbtRecursivePatRecAlg, 1);
@@ -23,80 +23,93 @@ int SbtSimpleClusteringAlg::Clusterize(std::vector<SbtDigi*> digis, std::vector<
   int iFrwd(0), iBkwd(0), iDigi(0);
   int nDigi = digis.size();
   int nclusters = 0;
+  if (nDigi == 0) return 0;
+
+  // the sub-list comes from a single layer/side
+  int maxChDist = maxChDistance;
+  if (digis[0]->GetDetectorElem()->GetDetectorType()->isFloatingStrip()) maxChDist *= 2;
+
+  // unpack the digis in contiguous arrays, then evaluate the seed
+  // condition in a single pass that the compiler can vectorize
+  _channel.resize(nDigi);
+  _adc.resize(nDigi);
+  _addendumThr.resize(nDigi);
+  _isSeed.resize(nDigi);
+  for (iDigi = 0; iDigi < nDigi; iDigi++) {
+    _channel[iDigi] = digis[iDigi]->GetChannelNumber();
+    _adc[iDigi] = digis[iDigi]->GetADC();
+    _addendumThr[iDigi] = digis[iDigi]->GetThr();
+  }
+  const double* adc = _adc.data();
+  double* thr = _addendumThr.data();
+  char* isSeed = _isSeed.data();
+  for (iDigi = 0; iDigi < nDigi; iDigi++) {
+    isSeed[iDigi] = adc[iDigi] >= minAdcClusterSeed * thr[iDigi];
+    thr[iDigi] *= minAdcClusterAddendum;
+  }
+  const int* channel = _channel.data();
+
   std::vector<SbtDigi*> selectedDigis;
   if (getDebugLevel() > 0) {
     std::cout << " SimpleClusteringAlg: start digi loop.\n";
   }
   for (iDigi = 0; iDigi < nDigi; iDigi++) {
-    selectedDigis.clear();
-    iFrwd = 0;
-    iBkwd = 0;
-    int maxChDist = maxChDistance;
-    if (digis[iDigi]->GetDetectorElem()->GetDetectorType()->isFloatingStrip()) maxChDist *= 2;
-    if (((digis[iDigi])->GetADC()) >=
-        minAdcClusterSeed * ((digis[iDigi])->GetThr())) {
-      if (getDebugLevel() > 0)
-        std::cout << "A digi is good for a cluster seed!\n";
+    if (!isSeed[iDigi]) continue;
+    if (getDebugLevel() > 0)
+      std::cout << "A digi is good for a cluster seed!\n";
 
-      selectedDigis.push_back(digis[iDigi]);
-      iFrwd++;
-      iBkwd++;
-      // looking in the forward direction for a digi that:
-      // 1) has a meaningful index
-      // 2) has an over-threshold adc value
-      // 3) is contiguos
-      while (1 && ((iDigi + iFrwd) < nDigi)  // 1)
-             && ((digis[iDigi + iFrwd])->GetADC() >=
-                 minAdcClusterAddendum * ((digis[iDigi])->GetThr()))  // 2)
-             && abs(digis[iDigi + iFrwd - 1]->GetChannelNumber() -
-                    digis[iDigi + iFrwd]->GetChannelNumber()) <=
-                    (iFrwd * maxChDist)  // 3)
-      ) {
-        if (getDebugLevel() > 0) {
-          std::cout << "Adding a 'forward' digi...\t";
-          std::cout << "Distance is: "
-                    << abs(digis[iDigi]->GetChannelNumber() -
-                           digis[iDigi + iFrwd]->GetChannelNumber())
-                    << "\n";
-        }
-        selectedDigis.push_back(digis[iDigi + iFrwd]);
-        iFrwd++;
-      }
-      iFrwd--;
-      // looking in the backward direction for a digi that:
-      // 1) has a meaningful index
-      // 2) has an over-threshold adc value
-      // 3) is contiguos
-      while (1 && ((iDigi - iBkwd) >= 0)  // 1)
-             && ((digis[iDigi - iBkwd])->GetADC() >=
-                 minAdcClusterAddendum * ((digis[iDigi])->GetThr()))  // 2)
-             && abs(digis[iDigi - iBkwd + 1]->GetChannelNumber() -
-                    digis[iDigi - iBkwd]->GetChannelNumber()) <=
-                    (iBkwd * maxChDist)  // 3)
-      ) {
-        if (getDebugLevel() > 0) {
-          std::cout << "Adding a 'backward' digi...\t";
-          std::cout << "Distance is: "
-                    << abs(digis[iDigi]->GetChannelNumber() -
-                           digis[iDigi - iBkwd]->GetChannelNumber())
-                    << "\n";
-        }
-        selectedDigis.push_back(digis[iDigi - iBkwd]);
-        iBkwd++;
-      }
-      iBkwd--;
-    }
-    iDigi += iFrwd;
-    if (!selectedDigis.empty()) {
+    selectedDigis.clear();
+    selectedDigis.push_back(digis[iDigi]);
+    iFrwd = 1;
+    iBkwd = 1;
+    // the addendum threshold is the one of the seed
+    const double seedAddendumThr = thr[iDigi];
+    // looking in the forward direction for a digi that:
+    // 1) has a meaningful index
+    // 2) has an over-threshold adc value
+    // 3) is contiguos
+    while (((iDigi + iFrwd) < nDigi)                                    // 1)
+           && (adc[iDigi + iFrwd] >= seedAddendumThr)                   // 2)
+           && abs(channel[iDigi + iFrwd - 1] - channel[iDigi + iFrwd]) <=
+                  (iFrwd * maxChDist)                                   // 3)
+    ) {
       if (getDebugLevel() > 0) {
-        std::cout << " SimpleClusteringAlg: creating new cluster. size: "
-                  << selectedDigis.size() << "\n";
+        std::cout << "Adding a 'forward' digi...\t";
+        std::cout << "Distance is: "
+                  << abs(channel[iDigi] - channel[iDigi + iFrwd]) << "\n";
       }
-      clusterList.push_back(SbtCluster(selectedDigis));
-      ++nclusters;
+      selectedDigis.push_back(digis[iDigi + iFrwd]);
+      iFrwd++;
+    }
+    iFrwd--;
+    // looking in the backward direction for a digi that:
+    // 1) has a meaningful index
+    // 2) has an over-threshold adc value
+    // 3) is contiguos
+    while (((iDigi - iBkwd) >= 0)                                       // 1)
+           && (adc[iDigi - iBkwd] >= seedAddendumThr)                   // 2)
+           && abs(channel[iDigi - iBkwd + 1] - channel[iDigi - iBkwd]) <=
+                  (iBkwd * maxChDist)                                   // 3)
+    ) {
       if (getDebugLevel() > 0) {
-        clusterList.back().print();
+        std::cout << "Adding a 'backward' digi...\t";
+        std::cout << "Distance is: "
+                  << abs(channel[iDigi] - channel[iDigi - iBkwd]) << "\n";
       }
+      selectedDigis.push_back(digis[iDigi - iBkwd]);
+      iBkwd++;
+    }
+    iBkwd--;
+    iDigi += iFrwd;
+
+    if (getDebugLevel() > 0) {
+      std::cout << " SimpleClusteringAlg: creating new cluster. size: "
+                << selectedDigis.size() << "\n";
+    }
+    clusterList.push_back(SbtCluster(selectedDigis));
+    ++nclusters;
+    if (getDebugLevel() > 0) {
+      clusterList.back().print();
     }
   }
   return nclusters;
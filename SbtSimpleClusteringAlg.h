@@ -1,6 +1,8 @@
 #ifndef SBT_SIMPLECLUSTERINGALG
 #define SBT_SIMPLECLUSTERINGALG
 
+#include <vector>
+
 #include "SbtClusteringAlg.h"
 
 class SbtSimpleClusteringAlg : public SbtClusteringAlg {
@@ -8,9 +10,17 @@ class SbtSimpleClusteringAlg : public SbtClusteringAlg {
   SbtSimpleClusteringAlg();
   ~SbtSimpleClusteringAlg();
 
+  // digis are expected to belong to a single layer/side and to be
+  // ordered by channel number
   int Clusterize(std::vector<SbtDigi*> digis, std::vector<SbtCluster>& clusters);
 
  protected:
+  // per sub-list work arrays, kept between calls to avoid reallocation
+  std::vector<int> _channel;
+  std::vector<double> _adc;
+  std::vector<double> _addendumThr;
+  std::vector<char> _isSeed;
+
   ClassDef(SbtSimpleClusteringAlg, 1);
 };
 #endif
@@ -59,50 +59,52 @@ int SbtSimplePatRecAlg::_linkHits() {
   if (!FindTelescopeDet(_currentEvent->GetSpacePointList())) return 0;
 
   // create the candidate tracks with 4 SpacePoints
-  std::vector<SbtSpacePoint*>::iterator SPIterator0;
-  std::vector<SbtSpacePoint*>::iterator SPIterator3;
-  std::vector<SbtSpacePoint*>::iterator SPIterator1;
-  std::vector<SbtSpacePoint*>::iterator SPIterator2;
-  // loop on outer telescope detector0  SpacePoints
-  for (SPIterator0 = _detSpacePointList[_trackDetID[0]].begin();
-       SPIterator0 != _detSpacePointList[_trackDetID[0]].end(); SPIterator0++) {
-    // loop on outer telescope detector3  SpacePoints
-    for (SPIterator3 = _detSpacePointList[_trackDetID[3]].begin();
-         SPIterator3 != _detSpacePointList[_trackDetID[3]].end();
-         SPIterator3++) {
-      // loop on inner telescope detector1  SpacePoints
-      for (SPIterator1 = _detSpacePointList[_trackDetID[1]].begin();
-           SPIterator1 != _detSpacePointList[_trackDetID[1]].end();
-           SPIterator1++) {
-        // check if the Internal SP is within the track nominal road
-        // pay attention: SP ordering matters below
-        if (!isInsideTrkRoad(*SPIterator0, *SPIterator3, *SPIterator1))
-          continue;
-        // loop on inner telescope detector2  SpacePoints
-        for (SPIterator2 = _detSpacePointList[_trackDetID[2]].begin();
-             SPIterator2 != _detSpacePointList[_trackDetID[2]].end();
-             SPIterator2++) {
-          // check if the Internal SP is within the track nominal road
-          // pay attention: SP ordering matters below
-          if (!isInsideTrkRoad(*SPIterator0, *SPIterator3, *SPIterator2))
-            continue;
-
-          // Finall we will remove the checks below,
-          // for the moment we keep it for debugging purposes: it is redundant
-
-          // check if the candidate track is a good one
-          // require distance of the SpacePoints from the trajectory
-          // to be within the cuts
-          bool isGoodTrack = isCandidateTrack(*SPIterator0, *SPIterator1,
-                                              *SPIterator2, *SPIterator3);
-          if (isGoodTrack) {
-            //	   start to build the tracks using SpacePoints
-            _currentEvent->AddTrack(SbtTrack(*SPIterator0, *SPIterator1, *SPIterator2, *SPIterator3));
-            TrkCounter++;
-          }
+  // each pair of outer SpacePoints (detector0, detector3) is a seed: the
+  // seeds are searched in parallel and the tracks are built in seed order
+  // (only the pairs within the beam slope window, if there is one)
+  std::vector<SbtSpacePoint*>& spList0 = _detSpacePointList[_trackDetID[0]];
+  std::vector<SbtSpacePoint*>& spList1 = _detSpacePointList[_trackDetID[1]];
+  std::vector<SbtSpacePoint*>& spList2 = _detSpacePointList[_trackDetID[2]];
+  std::vector<SbtSpacePoint*>& spList3 = _detSpacePointList[_trackDetID[3]];
+  CandidateList candidates;
+  runSeeds(makeSeeds(0, 3), [&](int seed, int worker, CandidateList& found) {
+    int i0, i3;
+    getSeed(seed, i0, i3);
+    SbtSpacePoint* sp0 = spList0[i0];
+    SbtSpacePoint* sp3 = spList3[i3];
+    // check which Internal SPs are within the track nominal road
+    // pay attention: SP ordering matters below
+    SbtLineSegment line(sp0->point(), sp3->point());
+    int id1 = _trackDetID[1], id2 = _trackDetID[2];
+    uint64_t* inRoad1 = roadMask(worker, 1, spList1.size());
+    uint64_t* inRoad2 = roadMask(worker, 2, spList2.size());
+    line.pointsInRoad(spList1.size(), _spX[id1].data(), _spY[id1].data(), _spZ[id1].data(), getRoadWidth(1), inRoad1);
+    line.pointsInRoad(spList2.size(), _spX[id2].data(), _spY[id2].data(), _spZ[id2].data(), getRoadWidth(2), inRoad2);
+    // loop on inner telescope detector1  SpacePoints
+    for (unsigned int i1 = 0; i1 < spList1.size(); i1++) {
+      if (!SbtLineSegment::inMask(inRoad1, i1)) continue;
+      // loop on inner telescope detector2  SpacePoints
+      for (unsigned int i2 = 0; i2 < spList2.size(); i2++) {
+        if (!SbtLineSegment::inMask(inRoad2, i2)) continue;
+
+        // Finall we will remove the checks below,
+        // for the moment we keep it for debugging purposes: it is redundant
+
+        // check if the candidate track is a good one
+        // require distance of the SpacePoints from the trajectory
+        // to be within the cuts
+        if (isCandidateTrack(sp0, spList1[i1], spList2[i2], sp3)) {
+          found.push_back({sp0, spList1[i1], spList2[i2], sp3});
         }
       }
     }
+    return 0;
+  }, candidates);
+
+  //	 start to build the tracks using SpacePoints
+  for (auto& SPList : candidates) {
+    _currentEvent->AddTrack(SbtTrack(SPList[0], SPList[1], SPList[2], SPList[3]));
+    TrkCounter++;
   }
   if (getDebugLevel() > 1) {
     std::cout << "SbtSimplePatRec: TrkCounter = " << TrkCounter << std::endl;
@@ -110,32 +112,10 @@ int SbtSimplePatRecAlg::_linkHits() {
   return TrkCounter;
 }
 
-bool SbtSimplePatRecAlg::isInsideTrkRoad(SbtSpacePoint* sp0, SbtSpacePoint* sp3,
-                                         SbtSpacePoint* spInternal) {
-  bool passed = false;
-
-  TVector3 x0 = sp0->point();
-  TVector3 x3 = sp3->point();
-  TVector3 xInternal = spInternal->point();
-
-  SbtLineSegment line(x0, x3);
-  if (line.distance(xInternal) < _roadWidth) {
-    passed = true;
-  } else {
-    passed = false;
-  }
-  if (getDebugLevel() > 1) {
-    std::cout << "SbtSimplePatRec: Distance xInternal = " << line.distance(xInternal)
-         << std::endl;
-  }
-
-  return passed;
-}
-
 bool SbtSimplePatRecAlg::isCandidateTrack(SbtSpacePoint* sp1,
                                           SbtSpacePoint* sp2,
                                           SbtSpacePoint* sp3,
-                                          SbtSpacePoint* sp4) {
+                                          SbtSpacePoint* sp4) const {
   bool passed = false;
 
   std::vector<SbtSpacePoint*> tmpSPList;
@@ -171,7 +151,7 @@ bool SbtSimplePatRecAlg::isCandidateTrack(SbtSpacePoint* sp1,
     std::cout << std::endl;
   }
 
-  if (line.distance(x2) < _roadWidth && line.distance(x3) < _roadWidth) {
+  if (line.distance(x2) < getRoadWidth(1) && line.distance(x3) < getRoadWidth(2)) {
     passed = true;
   }
   else {
@@ -184,7 +164,7 @@ bool SbtSimplePatRecAlg::isCandidateTrack(SbtSpacePoint* sp1,
   return passed;
 }
 
-void SbtSimplePatRecAlg::SortSpacePoints(std::vector<SbtSpacePoint*>& SPList) {
+void SbtSimplePatRecAlg::SortSpacePoints(std::vector<SbtSpacePoint*>& SPList) const {
   // try this
   std::sort(SPList.begin(), SPList.end(), SbtSpacePoint::ltz_ptr);
 }
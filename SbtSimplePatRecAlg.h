@@ -20,11 +20,8 @@ class SbtSimplePatRecAlg : public SbtPatRecAlg {
   bool isCandidateTrack(SbtSpacePoint* outerSpacePoint0,
                         SbtSpacePoint* outerSpacePoint1,
                         SbtSpacePoint* innerSpacePoint0,
-                        SbtSpacePoint* innerSpacePoint1);
-  bool isInsideTrkRoad(SbtSpacePoint* outerSpacePoint0,
-                       SbtSpacePoint* outerSpacePoint1,
-                       SbtSpacePoint* innerSpacePoint);
-  void SortSpacePoints(std::vector<SbtSpacePoint*>& SPList);
+                        SbtSpacePoint* innerSpacePoint1) const;
+  void SortSpacePoints(std::vector<SbtSpacePoint*>& SPList) const;
   int _linkHits();
 
   ClassDef(SbtSimplePatRecAlg, 1);
@@ -2,6 +2,7 @@
 #include <cassert>
 #include <cmath>
 #include <iostream>
+#include <map>
 
 #include <TVector3.h>
 
@@ -68,15 +69,6 @@ int SbtSingleSidePatRecAlg::_linkHits() {
 
   if (FindTelescopeDet(_currentEvent->GetSpacePointList()) == 0) return 0;
 
-  // create the candidate tracks with n SpacePoints
-  // n = _nTrackDet, the number of tracking detectors
-
-  // define here the std::vector of SpacePoint iterators
-  std::vector<std::vector<SbtSpacePoint*>::iterator> SPIterator;
-  std::vector<std::vector<SbtSpacePoint*>::iterator> SPIterator_X;
-  std::vector<std::vector<SbtSpacePoint*>::iterator> SPIterator_Y;
-  std::vector<SbtSpacePoint*>::iterator tmpIter;
-
   // HERE BUILD THE LIST OF TRACKING DETECTOR FOR X AND Y
 
   const SbtDetectorElem* detElem = nullptr;
@@ -88,7 +80,6 @@ int SbtSingleSidePatRecAlg::_linkHits() {
     if (_detSpacePointList[_trackDetID[i]].size() == 0) continue;
     detElem = _detSpacePointList[_trackDetID[i]].at(0)->GetDetectorElem();  // mi basta guardare un punto
 
-    assert(detElem->GetDetectorType()->GetType() == "singleside");  // temporaneamente
     if (detElem->GetDetectorType()->GetType() == "singleside") {  // se è singleside controllo se è U oppure V e aggiungo alla lista corrispondente
       rot = detElem->GetRotation();
       rot->GetAngles(phi, theta, psi);
@@ -114,97 +105,70 @@ int SbtSingleSidePatRecAlg::_linkHits() {
   _nTrackDet_X = _trackDetID_X.size();
   _nTrackDet_Y = _trackDetID_Y.size();
 
-  for (unsigned int i = 0; i < _nTrackDet; i++) {
-    SPIterator.push_back(tmpIter);
-  }
-  for (unsigned int i = 0; i < _nTrackDet_X; i++) {
-    SPIterator_X.push_back(tmpIter);
-  }
-  for (unsigned int i = 0; i < _nTrackDet_Y; i++) {
-    SPIterator_Y.push_back(tmpIter);
-  }
-
-  if (_nTrackDet_X != 0) {
-    // loop on outer telescope (first detector)  SpacePoints
-    for (SPIterator_X.front() = _detSpacePointList[_trackDetID_X[0]].begin();
-         SPIterator_X.front() != _detSpacePointList[_trackDetID_X[0]].end();
-         SPIterator_X.front()++) {
-      // loop on outer telescope (last detector)  SpacePoints
-      for (SPIterator_X.back() =
-               _detSpacePointList[_trackDetID_X[_nTrackDet_X - 1]].begin();
-           SPIterator_X.back() !=
-           _detSpacePointList[_trackDetID_X[_nTrackDet_X - 1]].end();
-           SPIterator_X.back()++) {
-        // loop on inner telescope detector SpacePoints
-        unsigned int k = 1;
-
-        LoopOnSpacePoints(SPIterator_X, k, 0);  // 0 stands for X
-      }  // close loop on outer detector, last one
-    }    // close loop on outer detector, first one
-    SPIterator_X.clear();
-  }
-
-  if (_nTrackDet_Y != 0) {
-    // loop on outer telescope (first detector)  SpacePoints
-    for (SPIterator_Y.front() = _detSpacePointList[_trackDetID_Y[0]].begin();
-         SPIterator_Y.front() != _detSpacePointList[_trackDetID_Y[0]].end();
-         SPIterator_Y.front()++) {
-      // loop on outer telescope (last detector)  SpacePoints
-      for (SPIterator_Y.back() =
-               _detSpacePointList[_trackDetID_Y[_nTrackDet_Y - 1]].begin();
-           SPIterator_Y.back() !=
-           _detSpacePointList[_trackDetID_Y[_nTrackDet_Y - 1]].end();
-           SPIterator_Y.back()++) {
-        // loop on inner telescope detector SpacePoints
-        unsigned int k = 1;
-
-        LoopOnSpacePoints(SPIterator_Y, k, 1);  // 1 stands for Y
-      }  // close loop on outer detector, last one
-    }    // close loop on outer detector, first one
-    SPIterator_Y.clear();
-  }
+  // create the 2D candidate tracks in each projection
+  findProjectionTracks(0, _SingleSidePatRecTrackList_X);  // 0 stands for X
+  findProjectionTracks(1, _SingleSidePatRecTrackList_Y);  // 1 stands for Y
+  _trkCounter_X = _SingleSidePatRecTrackList_X.size();
+  _trkCounter_Y = _SingleSidePatRecTrackList_Y.size();
 
   // HERE MERGE THE TRACKs
-  std::vector<SbtTrack*>::iterator TrackListIter_X;
-  std::vector<SbtTrack*>::iterator TrackListIter_Y;
-  std::vector<SbtSpacePoint*> aSpacePointList_X;
-  std::vector<SbtSpacePoint*> aSpacePointList_Y;
-
   std::vector<SbtSpacePoint*> spacePointList_merged;
 
   if (_SingleSidePatRecTrackList_X.size() == 0) {
-    for (TrackListIter_Y = _SingleSidePatRecTrackList_Y.begin();
-         TrackListIter_Y != _SingleSidePatRecTrackList_Y.end();
-         TrackListIter_Y++) {
-      spacePointList_merged = (*TrackListIter_Y)->GetSpacePointList();
+    for (auto& aSpacePointList_Y : _SingleSidePatRecTrackList_Y) {
+      spacePointList_merged = aSpacePointList_Y;
       SortSpacePoints(spacePointList_merged);
       _currentEvent->AddTrack(SbtTrack(spacePointList_merged));
       ++_trkCounter;
     }
   } else if (_SingleSidePatRecTrackList_Y.size() == 0) {
-    for (TrackListIter_X = _SingleSidePatRecTrackList_X.begin();
-         TrackListIter_X != _SingleSidePatRecTrackList_X.end();
-         TrackListIter_X++) {
-      spacePointList_merged = (*TrackListIter_X)->GetSpacePointList();
+    for (auto& aSpacePointList_X : _SingleSidePatRecTrackList_X) {
+      spacePointList_merged = aSpacePointList_X;
       SortSpacePoints(spacePointList_merged);
       _currentEvent->AddTrack(SbtTrack(spacePointList_merged));
       ++_trkCounter;
     }
   } else {
-    for (TrackListIter_X = _SingleSidePatRecTrackList_X.begin();
-         TrackListIter_X != _SingleSidePatRecTrackList_X.end();
-         TrackListIter_X++) {
-      for (TrackListIter_Y = _SingleSidePatRecTrackList_Y.begin();
-           TrackListIter_Y != _SingleSidePatRecTrackList_Y.end();
-           TrackListIter_Y++) {
-        spacePointList_merged.clear();
-        aSpacePointList_X = (*TrackListIter_X)->GetSpacePointList();
-        aSpacePointList_Y = (*TrackListIter_Y)->GetSpacePointList();
-
-        spacePointList_merged = aSpacePointList_Y;
-        spacePointList_merged.insert(spacePointList_merged.end(),
-                                     aSpacePointList_X.begin(),
-                                     aSpacePointList_X.end());
+    // the planes measuring both coordinates are in both projections: an X
+    // and a Y candidate are merged only if they have the same space points
+    // on these planes. The Y candidates are indexed by those space points,
+    // so each X candidate only visits its matches. Without such planes
+    // every pair of X and Y candidates is a track.
+    std::vector<int> commonX, commonY;
+    for (unsigned int kx = 0; kx < _nTrackDet_X; kx++) {
+      for (unsigned int ky = 0; ky < _nTrackDet_Y; ky++) {
+        if (_trackDetID_X[kx] != _trackDetID_Y[ky]) continue;
+        commonX.push_back(kx);
+        commonY.push_back(ky);
+      }
+    }
+
+    std::map<std::vector<SbtSpacePoint*>, std::vector<int> > yByShared;
+    std::vector<SbtSpacePoint*> shared(commonY.size());
+    for (unsigned int iY = 0; iY < _SingleSidePatRecTrackList_Y.size(); iY++) {
+      for (unsigned int c = 0; c < commonY.size(); c++) {
+        shared[c] = _SingleSidePatRecTrackList_Y[iY][commonY[c]];
+      }
+      yByShared[shared].push_back(iY);
+    }
+
+    for (auto& aSpacePointList_X : _SingleSidePatRecTrackList_X) {
+      for (unsigned int c = 0; c < commonX.size(); c++) {
+        shared[c] = aSpacePointList_X[commonX[c]];
+      }
+      auto match = yByShared.find(shared);
+      if (match == yByShared.end()) continue;
+      for (int iY : match->second) {
+        // the shared space points are taken from the Y candidate only
+        spacePointList_merged = _SingleSidePatRecTrackList_Y[iY];
+        unsigned int c = 0;
+        for (unsigned int kx = 0; kx < _nTrackDet_X; kx++) {
+          if (c < commonX.size() && commonX[c] == (int)kx) {
+            c++;
+            continue;
+          }
+          spacePointList_merged.push_back(aSpacePointList_X[kx]);
+        }
 
         SortSpacePoints(spacePointList_merged);
         _currentEvent->AddTrack(SbtTrack(spacePointList_merged));
@@ -259,8 +223,7 @@ bool SbtSingleSidePatRecAlg::isInsideTrkRoad(SbtSpacePoint* sp0,
   return passed;
 }
 
-bool SbtSingleSidePatRecAlg::isCandidateTrack(
-    std::vector<std::vector<SbtSpacePoint*>::iterator> SPIter, unsigned int index) const {
+bool SbtSingleSidePatRecAlg::isCandidateTrack(const std::vector<SbtSpacePoint*>& SPList, unsigned int index) const {
   bool passed = false;
 
   if (getDebugLevel() > 1) {
@@ -279,10 +242,10 @@ bool SbtSingleSidePatRecAlg::isCandidateTrack(
 
   std::vector<SbtSpacePoint*> tmpSPList;
   for (unsigned int i = 0; i < tempnTrackDet; i++) {
-    tmpSPList.push_back(*SPIter.at(i));
+    tmpSPList.push_back(SPList.at(i));
     if (getDebugLevel() > 1) {
       std::cout << "Space Point List = " << std::endl;
-      TVector3 x = (*SPIter.at(i))->point();
+      TVector3 x = SPList.at(i)->point();
       x.Print();
     }
   }
@@ -384,58 +347,105 @@ bool SbtSingleSidePatRecAlg::isCandidateTrack(SbtSpacePoint* sp1,
   return passed;
 }
 
-void SbtSingleSidePatRecAlg::LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::iterator>& SPIter, unsigned int k, unsigned int index) {
+//
+// 2D tracking in one projection. The space points of each inner plane are
+// sorted by their coordinate u. A point at distance d from the road line
+// of slope t is at most d * sqrt(1 + t^2) away in u from the line at its
+// own z, and the line moves by at most |t| * dzMax from its crossing at
+// the mean z of the plane: the space points in the road of a seed are in
+// a binary search range of the sorted plane.
+//
+void SbtSingleSidePatRecAlg::findProjectionTracks(unsigned int index, CandidateList& found) {
+  assert(index == 0 || index == 1);
+  const std::vector<int>& temptrackDetID = index == 0 ? _trackDetID_X : _trackDetID_Y;
+  unsigned int tempnTrackDet = temptrackDetID.size();
+  found.clear();
+  // a 2D candidate needs at least one inner plane
+  if (tempnTrackDet < 3) return;
+
+  for (unsigned int k = 1; k < tempnTrackDet - 1; k++) {
+    std::vector<SbtSpacePoint*>& spList = _detSpacePointList[temptrackDetID[k]];
+    int n = spList.size();
+    std::vector<std::pair<double, int> > sorted(n);
+    _planeZ[k] = 0;
+    for (int i = 0; i < n; i++) {
+      sorted[i] = std::make_pair(index == 0 ? spList[i]->GetXPosition() : spList[i]->GetYPosition(), i);
+      _planeZ[k] += spList[i]->GetZPosition();
+    }
+    _planeZ[k] /= n;
+    _planeDeltaZ[k] = 0;
+    for (int i = 0; i < n; i++) {
+      _planeDeltaZ[k] = std::max(_planeDeltaZ[k], fabs(spList[i]->GetZPosition() - _planeZ[k]));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    _sortedU[k].resize(n);
+    _sortedIndex[k].resize(n);
+    for (int i = 0; i < n; i++) {
+      _sortedU[k][i] = sorted[i].first;
+      _sortedIndex[k][i] = sorted[i].second;
+    }
+  }
+
+  _candidate.resize(tempnTrackDet);
+  // loop on outer telescope (first detector) SpacePoints
+  for (auto sp0 : _detSpacePointList[temptrackDetID[0]]) {
+    _candidate.front() = sp0;
+    // loop on outer telescope (last detector) SpacePoints
+    for (auto spN : _detSpacePointList[temptrackDetID[tempnTrackDet - 1]]) {
+      _candidate.back() = spN;
+      // loop on inner telescope detector SpacePoints
+      LoopOnSpacePoints(1, index, found);
+    }
+  }
+}
+
+void SbtSingleSidePatRecAlg::LoopOnSpacePoints(unsigned int k, unsigned int index, CandidateList& found) {
   if (getDebugLevel() > 1) {
     std::cout << "SbtSingleSidePatRecAlg::LoopOnSpacePoints nested loop n. " << k
          << std::endl;
   }
 
-  // loop on inner telescope detector SpacePoints
-
-  std::vector<int> temptrackDetID;
-  unsigned int tempnTrackDet;
-
-  assert(index == 0 || index == 1);
-
-  if (index == 0) {
-    temptrackDetID = _trackDetID_X;
-    tempnTrackDet = _nTrackDet_X;
-  } else if (index == 1) {
-    temptrackDetID = _trackDetID_Y;
-    tempnTrackDet = _nTrackDet_Y;
+  const std::vector<int>& temptrackDetID = index == 0 ? _trackDetID_X : _trackDetID_Y;
+  unsigned int tempnTrackDet = temptrackDetID.size();
+  std::vector<SbtSpacePoint*>& spList = _detSpacePointList[temptrackDetID[k]];
+
+  // binary search of the road window on the sorted plane
+  SbtSpacePoint* sp0 = _candidate.front();
+  SbtSpacePoint* spN = _candidate.back();
+  double u0 = index == 0 ? sp0->GetXPosition() : sp0->GetYPosition();
+  double uN = index == 0 ? spN->GetXPosition() : spN->GetYPosition();
+  double dz = spN->GetZPosition() - sp0->GetZPosition();
+  std::vector<int>& inWindow = _inWindow[k];
+  inWindow.clear();
+  const std::vector<double>& sortedU = _sortedU[k];
+  if (dz != 0) {
+    double slope = (uN - u0) / dz;
+    double u = u0 + slope * (_planeZ[k] - sp0->GetZPosition());
+    double halfWidth = _roadWidth * sqrt(1 + slope * slope) + fabs(slope) * _planeDeltaZ[k];
+    auto first = std::lower_bound(sortedU.begin(), sortedU.end(), u - halfWidth);
+    auto last = std::upper_bound(first, sortedU.end(), u + halfWidth);
+    for (auto it = first; it != last; ++it) {
+      inWindow.push_back(_sortedIndex[k][it - sortedU.begin()]);
+    }
+    // keep the order of the space point list
+    std::sort(inWindow.begin(), inWindow.end());
+  }
+  else {
+    for (unsigned int i = 0; i < spList.size(); i++) inWindow.push_back(i);
   }
 
-  for (SPIter[k] = _detSpacePointList[temptrackDetID[k]].begin();
-       SPIter[k] != _detSpacePointList[temptrackDetID[k]].end(); SPIter[k]++) {
+  for (unsigned int iCandidate = 0; iCandidate < inWindow.size(); iCandidate++) {
+    _candidate[k] = spList[inWindow[iCandidate]];
     // check if the Internal SP is within the track nominal road
     // pay attention: SP ordering matters below
-
-    if (!isInsideTrkRoad(*SPIter.front(), *SPIter.back(), *SPIter[k], index))
-      continue;
+    if (!isInsideTrkRoad(sp0, spN, _candidate[k], index)) continue;
 
     if ((tempnTrackDet - 2) == k) {
-      bool isGoodTrack = isCandidateTrack(SPIter, index);
-
-      if (isGoodTrack) {
-        //  start to build the tracks using SpacePoints
-        std::vector<SbtSpacePoint*> SPList;
-        for (unsigned int i = 0; i < tempnTrackDet; i++) {
-          SPList.push_back(*SPIter.at(i));
-        }
-
-        SbtTrack* candidateTrack = new SbtTrack(SPList);
-        if (index == 0) {
-          _SingleSidePatRecTrackList_X.push_back(candidateTrack);
-          _trkCounter_X++;
-        } else if (index == 1) {
-          _SingleSidePatRecTrackList_Y.push_back(candidateTrack);
-          _trkCounter_Y++;
-        }
-      }
+      //  start to build the tracks using SpacePoints
+      if (isCandidateTrack(_candidate, index)) found.push_back(_candidate);
     }
-
-    if (k < (tempnTrackDet - 2)) {
-      LoopOnSpacePoints(SPIter, k + 1, index);
+    else {
+      LoopOnSpacePoints(k + 1, index, found);
     }
   }
 }
@@ -24,12 +24,22 @@ class SbtSingleSidePatRecAlg : public SbtPatRecAlg {
   int _trkCounter_Y;
 
   std::vector<SbtTrack*> _SingleSidePatRecTrackList;
-  std::vector<SbtTrack*> _SingleSidePatRecTrackList_X;
-  std::vector<SbtTrack*> _SingleSidePatRecTrackList_Y;
+  // space point lists of the 2D candidates, in the order of the planes
+  CandidateList _SingleSidePatRecTrackList_X;
+  CandidateList _SingleSidePatRecTrackList_Y;
   std::vector<int> _trackDetID_X;
   std::vector<int> _trackDetID_Y;
 
-  bool isCandidateTrack(std::vector<std::vector<SbtSpacePoint*>::iterator> SPIter, unsigned int index) const;
+  // inner planes of the current projection, sorted by coordinate:
+  // _sortedU[k][j] is the coordinate of space point _sortedIndex[k][j]
+  std::vector<double> _sortedU[maxNTelescopeDetector];  //!
+  std::vector<int> _sortedIndex[maxNTelescopeDetector];  //!
+  double _planeZ[maxNTelescopeDetector];  //! mean z of the space points
+  double _planeDeltaZ[maxNTelescopeDetector];  //! largest |z - _planeZ|
+  std::vector<int> _inWindow[maxNTelescopeDetector];  //!
+  std::vector<SbtSpacePoint*> _candidate;  //!
+
+  bool isCandidateTrack(const std::vector<SbtSpacePoint*>& SPList, unsigned int index) const;
   bool isCandidateTrack(SbtSpacePoint* outerSpacePoint0,
                         SbtSpacePoint* outerSpacePoint1,
                         SbtSpacePoint* innerSpacePoint0,
@@ -39,7 +49,9 @@ class SbtSingleSidePatRecAlg : public SbtPatRecAlg {
                        SbtSpacePoint* innerSpacePoint, unsigned int index) const;
   void SortSpacePoints(std::vector<SbtSpacePoint*>& SPList) const;
   void SortDetectorElems(std::vector<SbtDetectorElem*>& DEList) const;
-  void LoopOnSpacePoints(std::vector<std::vector<SbtSpacePoint*>::iterator>& SPIter, unsigned int k, unsigned int index);
+  // 2D candidates of projection index (0 for X, 1 for Y)
+  void findProjectionTracks(unsigned int index, CandidateList& found);
+  void LoopOnSpacePoints(unsigned int k, unsigned int index, CandidateList& found);
   int _linkHits();
 
   ClassDef(SbtSingleSidePatRecAlg, 1);
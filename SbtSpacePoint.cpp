@@ -20,7 +20,9 @@ SbtSpacePoint::SbtSpacePoint() :
   _digiType(SbtEnums::digiType::undefinedDigiType),
   _spacePointType(SbtEnums::objectType::reconstructed),
   _pxlCluster(nullptr),
-  _IsOnTrack(false) {
+  _IsOnTrack(false),
+  _chargeRatio(-1.),
+  _IsChargeCorrelated(true) {
   }
 
 SbtSpacePoint::SbtSpacePoint(TVector3 point, const SbtDetectorElem* detElem,
@@ -33,7 +35,9 @@ SbtSpacePoint::SbtSpacePoint(TVector3 point, const SbtDetectorElem* detElem,
   _errorMethod(ErrorMethod),
   _trackDetErr(trackDetErr),
   _digiType(SbtEnums::digiType::strip),
-  _spacePointType(SbtEnums::objectType::reconstructed) {
+  _spacePointType(SbtEnums::objectType::reconstructed),
+  _chargeRatio(-1.),
+  _IsChargeCorrelated(true) {
   if (_DebugLevel > 0)
     std::cout << "SbtSpacePoint:  DebugLevel= " << _DebugLevel << std::endl;
   // assing the cluster pointer for U and V side
@@ -72,7 +76,9 @@ SbtSpacePoint::SbtSpacePoint(TVector3 point, const SbtDetectorElem* detElem,
   _errorMethod(ErrorMethod),
   _trackDetErr(trackDetErr),
   _digiType(SbtEnums::digiType::strip),
-  _spacePointType(SbtEnums::objectType::reconstructed) {
+  _spacePointType(SbtEnums::objectType::reconstructed),
+  _chargeRatio(-1.),
+  _IsChargeCorrelated(true) {
   if (_DebugLevel > 0) {
     std::cout << "SbtSpacePoint:  DebugLevel= " << _DebugLevel << std::endl;
   }
@@ -101,7 +107,9 @@ SbtSpacePoint::SbtSpacePoint(TVector3 point, TVector3 pointErr,
   _point(point),
   _pointErr(pointErr),
   _digiType(SbtEnums::digiType::strip),
-  _spacePointType(SbtEnums::objectType::reconstructed) {
+  _spacePointType(SbtEnums::objectType::reconstructed),
+  _chargeRatio(-1.),
+  _IsChargeCorrelated(true) {
   if (_DebugLevel) std::cout << "SbtSpacePoint:  DebugLevel= " << _DebugLevel << std::endl;
   // assing the cluster pointer for U and V side
   if (HitA->GetSide() == SbtEnums::U && HitB->GetSide() == SbtEnums::V) {
@@ -128,7 +136,9 @@ SbtSpacePoint::SbtSpacePoint(TVector3 point, const SbtDetectorElem* detElem) :
   _detectorElem(detElem),
   _point(point),
   _digiType(SbtEnums::digiType::undefinedDigiType),
-  _spacePointType(SbtEnums::objectType::reconstructed) {
+  _spacePointType(SbtEnums::objectType::reconstructed),
+  _chargeRatio(-1.),
+  _IsChargeCorrelated(true) {
   if (_DebugLevel > 0) {
     std::cout << "SbtSpacePoint:  DebugLevel= " << _DebugLevel << std::endl;
   }
@@ -154,7 +164,9 @@ SbtSpacePoint::SbtSpacePoint(SbtCluster* pixelCluster, std::string ErrorMethod,
   _errorMethod(ErrorMethod),
   _trackDetErr(trackDetErr),
   _digiType(SbtEnums::digiType::pixel),
-  _spacePointType(SbtEnums::objectType::reconstructed) {
+  _spacePointType(SbtEnums::objectType::reconstructed),
+  _chargeRatio(-1.),
+  _IsChargeCorrelated(true) {
   _pxlCluster = pixelCluster;
   _hitU = nullptr;
   _hitV = nullptr;
@@ -194,6 +206,8 @@ SbtSpacePoint& SbtSpacePoint::operator=(const SbtSpacePoint& other) {
   _pointErr = other._pointErr;
   _detectorElem = other._detectorElem;
   _IsOnTrack = other._IsOnTrack;
+  _chargeRatio = other._chargeRatio;
+  _IsChargeCorrelated = other._IsChargeCorrelated;
   _DebugLevel = other._DebugLevel;
   _hitU = other._hitU;
   _hitV = other._hitV;
@@ -380,4 +394,7 @@ void SbtSpacePoint::print() const {
   std::cout << "Is on track " << _IsOnTrack << std::endl;
   std::cout << "Digit type " << _digiType << std::endl;
   std::cout << "Space point type " << _spacePointType << std::endl;
+  if (_chargeRatio >= 0) {
+    std::cout << "Charge ratio " << _chargeRatio << " correlated " << _IsChargeCorrelated << std::endl;
+  }
 }
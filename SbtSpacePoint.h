@@ -46,6 +46,15 @@ class SbtSpacePoint {
   SbtEnums::objectType GetSpacePointType() const { return _spacePointType; }
   void SetSpacePointType(SbtEnums::objectType type) { _spacePointType = type; }
 
+  // V/U pulse-height ratio of the two clusters and whether it falls in the
+  // calibrated window of the detector (always true if no window is set)
+  double GetChargeRatio() const { return _chargeRatio; }
+  bool IsChargeCorrelated() const { return _IsChargeCorrelated; }
+  void SetChargeCorrelation(double ratio, bool correlated) {
+    _chargeRatio = ratio;
+    _IsChargeCorrelated = correlated;
+  }
+
   SbtHit* GetHitU() const;
   SbtHit* GetHitV() const;
   SbtCluster* GetPxlCluster() const;
@@ -73,11 +82,13 @@ class SbtSpacePoint {
   SbtEnums::digiType _digiType;
   SbtEnums::objectType _spacePointType;
   bool _IsOnTrack;
+  double _chargeRatio;       // -1 if not evaluated
+  bool _IsChargeCorrelated;
   std::string _errorMethod;
   double _trackDetErr;
   const SbtDetectorElem* _detectorElem;
 
-  ClassDef(SbtSpacePoint, 1);
+  ClassDef(SbtSpacePoint, 2);
 };
 
 #endif
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+
+#include <TVector3.h>
+
+#include "SbtSpacePoint.h"
+#include "SbtSpacePointGrid.h"
+
+ClassImp(SbtSpacePointGrid);
+
+// the grid is kept small for planes with a large spread of space points
+static const int maxNCellsPerAxis = 64;
+
+SbtSpacePointGrid::SbtSpacePointGrid()
+    : _nx(0), _ny(0), _xMin(0), _yMin(0), _cellSize(1), _zRef(0), _dzMax(0) {}
+
+void SbtSpacePointGrid::fill(const std::vector<SbtSpacePoint*>& spList, double minCellSize) {
+  int n = spList.size();
+  _x.resize(n);
+  _y.resize(n);
+  _index.resize(n);
+  _zRef = 0;
+  _dzMax = 0;
+  if (n == 0) {
+    _nx = _ny = 0;
+    _cellStart.assign(1, 0);
+    return;
+  }
+
+  double xMax = -1e30, yMax = -1e30;
+  _xMin = 1e30;
+  _yMin = 1e30;
+  for (int i = 0; i < n; i++) {
+    _x[i] = spList[i]->GetXPosition();
+    _y[i] = spList[i]->GetYPosition();
+    _zRef += spList[i]->GetZPosition();
+    _xMin = std::min(_xMin, _x[i]);
+    _yMin = std::min(_yMin, _y[i]);
+    xMax = std::max(xMax, _x[i]);
+    yMax = std::max(yMax, _y[i]);
+  }
+  _zRef /= n;
+  for (int i = 0; i < n; i++) {
+    _dzMax = std::max(_dzMax, fabs(spList[i]->GetZPosition() - _zRef));
+  }
+
+  double extent = std::max(xMax - _xMin, yMax - _yMin);
+  _cellSize = std::max(minCellSize, extent / maxNCellsPerAxis);
+  if (_cellSize <= 0) _cellSize = 1;
+  _nx = std::min(int((xMax - _xMin) / _cellSize) + 1, maxNCellsPerAxis);
+  _ny = std::min(int((yMax - _yMin) / _cellSize) + 1, maxNCellsPerAxis);
+
+  // counting sort of the space points by cell
+  std::vector<int> cell(n);
+  _cellStart.assign(_nx * _ny + 1, 0);
+  for (int i = 0; i < n; i++) {
+    int ix = std::min(int((_x[i] - _xMin) / _cellSize), _nx - 1);
+    int iy = std::min(int((_y[i] - _yMin) / _cellSize), _ny - 1);
+    cell[i] = iy * _nx + ix;
+    _cellStart[cell[i] + 1]++;
+  }
+  for (int c = 0; c < _nx * _ny; c++) {
+    _cellStart[c + 1] += _cellStart[c];
+  }
+  std::vector<int> next(_cellStart.begin(), _cellStart.end() - 1);
+  for (int i = 0; i < n; i++) {
+    _index[next[cell[i]]++] = i;
+  }
+}
+
+void SbtSpacePointGrid::findCandidates(double x, double y, double radius,
+                                       std::vector<int>& candidates) const {
+  if (_nx == 0) return;
+  int ixMin = std::max(int(floor((x - radius - _xMin) / _cellSize)), 0);
+  int ixMax = std::min(int(floor((x + radius - _xMin) / _cellSize)), _nx - 1);
+  int iyMin = std::max(int(floor((y - radius - _yMin) / _cellSize)), 0);
+  int iyMax = std::min(int(floor((y + radius - _yMin) / _cellSize)), _ny - 1);
+  for (int iy = iyMin; iy <= iyMax; iy++) {
+    for (int ix = ixMin; ix <= ixMax; ix++) {
+      int c = iy * _nx + ix;
+      for (int k = _cellStart[c]; k < _cellStart[c + 1]; k++) {
+        int i = _index[k];
+        if (fabs(_x[i] - x) <= radius && fabs(_y[i] - y) <= radius) {
+          candidates.push_back(i);
+        }
+      }
+    }
+  }
+}
+
+//
+// A point at distance d from the line is at a transverse distance of at
+// most d / cos(theta) from the line crossing at its own z, theta being the
+// line angle to the z axis. The crossing at the space point z moves by at
+// most |slope| * _dzMax from the crossing at _zRef, hence the search radius.
+//
+void SbtSpacePointGrid::findInRoad(const TVector3& x0, const TVector3& x1, double roadWidth,
+                                   std::vector<int>& candidates) const {
+  candidates.clear();
+  TVector3 dir = x1 - x0;
+  if (dir.Z() == 0) {
+    // no crossing point, return all the space points
+    for (int i = 0; i < getNSpacePoints(); i++) candidates.push_back(i);
+    return;
+  }
+  double tx = dir.X() / dir.Z();
+  double ty = dir.Y() / dir.Z();
+  double x = x0.X() + tx * (_zRef - x0.Z());
+  double y = x0.Y() + ty * (_zRef - x0.Z());
+  double radius = roadWidth * dir.Mag() / fabs(dir.Z()) + sqrt(tx * tx + ty * ty) * _dzMax;
+
+  findCandidates(x, y, radius, candidates);
+  // keep the order of the space point list
+  std::sort(candidates.begin(), candidates.end());
+}
@@ -0,0 +1,55 @@
+#ifndef SBTSPACEPOINTGRID_HH
+#define SBTSPACEPOINTGRID_HH
+
+#include <vector>
+
+#include <Rtypes.h>
+
+class SbtSpacePoint;
+class TVector3;
+
+//
+// Description
+//
+// bins the space points of one detector plane in a 2D (x, y) grid, so that
+// the pattern recognition only visits the space points close to the
+// crossing point of a track road instead of the whole plane
+
+class SbtSpacePointGrid {
+ public:
+  SbtSpacePointGrid();
+  ~SbtSpacePointGrid() {;}
+
+  // bin the space points in square cells of at least minCellSize
+  void fill(const std::vector<SbtSpacePoint*>& spList, double minCellSize);
+
+  // indices in the filled list, in increasing order, of the space points
+  // that may lie within roadWidth of the line through x0 and x1
+  void findInRoad(const TVector3& x0, const TVector3& x1, double roadWidth,
+                  std::vector<int>& candidates) const;
+
+  // indices of the space points in the cells overlapping the square of
+  // half-side radius around (x, y), not sorted
+  void findCandidates(double x, double y, double radius,
+                      std::vector<int>& candidates) const;
+
+  int getNSpacePoints() const { return _x.size(); }
+  double getZ() const { return _zRef; }
+  double getDeltaZ() const { return _dzMax; }
+
+ protected:
+  int _nx, _ny;
+  double _xMin, _yMin;
+  double _cellSize;
+  double _zRef;   // mean z of the space points
+  double _dzMax;  // largest |z - _zRef| (tilted planes)
+
+  std::vector<double> _x;
+  std::vector<double> _y;
+  std::vector<int> _cellStart;  // _index[_cellStart[c].._cellStart[c+1]] in cell c
+  std::vector<int> _index;
+
+  ClassDef(SbtSpacePointGrid, 0);
+};
+
+#endif
@@ -37,15 +37,14 @@ void SbtStripletsDetectorElem::ChannelToLocal(int chip, int channel, char side,
 }
 
 void SbtStripletsDetectorElem::LocalToMaster(double *local, double *master) const {
-  double localprime[3];
-  LocalToLocalPrime(local, localprime);
-  LocalPrimeToMaster(localprime, master);
+  // the cached transform already includes the rotation to local prime
+  CheckTransforms();
+  ApplyTransform(_localToMasterT, local, master);
 }
 
 void SbtStripletsDetectorElem::MasterToLocal(double *master, double *local) const {
-  double localprime[3];
-  MasterToLocalPrime(master, localprime);
-  LocalPrimeToLocal(localprime, local);
+  CheckTransforms();
+  ApplyTransform(_masterToLocalT, master, local);
 }
 
 bool SbtStripletsDetectorElem::InActiveArea(TVector3 point) const {
@@ -68,3 +67,24 @@ bool SbtStripletsDetectorElem::InActiveArea(TVector3 point) const {
     return false;
   }
 }
+
+int SbtStripletsDetectorElem::InActiveArea(int n, const double *u, const double *v, unsigned char *ok) const {
+  SbtDetectorElem::InActiveArea(n, u, v, ok);
+
+  // now check if on the physical silicon
+  CheckTransforms();
+  double c = _cosStripAngle;
+  double s = _sinStripAngle;
+  double uPrimeMin = _detType->GetUPrimeActMin();
+  double uPrimeMax = _detType->GetUPrimeActMax();
+  double vPrimeMin = _detType->GetVPrimeActMin();
+  double vPrimeMax = _detType->GetVPrimeActMax();
+  int nOk = 0;
+  for (int i = 0; i < n; i++) {
+    double uPrime = c * u[i] - s * v[i];
+    double vPrime = s * u[i] + c * v[i];
+    ok[i] &= (uPrime > uPrimeMin) & (uPrime < uPrimeMax) & (vPrime > vPrimeMin) & (vPrime < vPrimeMax);
+    nOk += ok[i];
+  }
+  return nOk;
+}
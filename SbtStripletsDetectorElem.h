@@ -28,6 +28,7 @@ class SbtStripletsDetectorElem : public SbtDetectorElem {
   // needs its own function
 
   bool InActiveArea(TVector3 point) const;
+  int InActiveArea(int n, const double *u, const double *v, unsigned char *ok) const;
 
   // define a function that given the electronic address
   // return the local coordinate address of the striplet
@@ -37,6 +38,11 @@ class SbtStripletsDetectorElem : public SbtDetectorElem {
   void GetStripDigiData(int channel, int &chip, int &set, int &strip) const;
   void GetPxlDigiData(int Row, int Rolumn, int &macroColumn, int &columnInMP, int &row) const { assert(0); }
 
+ protected:
+  // batch transforms include the rotation to local prime as well
+  const double* LocalToMasterTransform() const { return _localToMasterT; }
+  const double* MasterToLocalTransform() const { return _masterToLocalT; }
+
   ClassDef(SbtStripletsDetectorElem, 1);  // Implementation of StripletsDetectorElem
 };
 
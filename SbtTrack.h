@@ -42,6 +42,8 @@ class SbtTrack {
   void reset();
 
   void SortSpacePoints();
+  // flag the space points, hits, clusters and digis of the track as on track
+  void SetIsOnTrack();
 
   void AddHit(SbtHit* aHit);
   void AddSpacePoint(SbtSpacePoint* aSpacePoint);
@@ -166,7 +168,6 @@ class SbtTrack {
   std::vector<double> _simulationPointZ; // position z at each geometrical node for simulated tracks
 
   void Residual(SbtSpacePoint* SP, int i);
-  void SetIsOnTrack();
   void SetDigiIsOnTrack(std::vector<SbtDigi*> aDigiList);
   TF1* CreateLinearTrackFunction() const;
   bool IntersectPlane(TVector3 p1, TVector3 p2, const SbtDetectorElem* detElem, TVector3& point) const;
@@ -0,0 +1,71 @@
+#include <cassert>
+
+#include "SbtWorkerPool.h"
+
+ClassImp(SbtWorkerPool);
+
+SbtWorkerPool::SbtWorkerPool(int nWorkers)
+    : _nWorkers(nWorkers), _nTasks(0), _task(nullptr), _nextTask(0), _generation(0), _nBusy(0), _quit(false) {
+  assert(_nWorkers >= 1);
+  for (int iWorker = 1; iWorker < _nWorkers; iWorker++) {
+    _threads.push_back(std::thread(&SbtWorkerPool::work, this, iWorker));
+  }
+}
+
+SbtWorkerPool::~SbtWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _quit = true;
+  }
+  _startRun.notify_all();
+  for (auto& thread : _threads) thread.join();
+}
+
+void SbtWorkerPool::run(int nTasks, const std::function<void(int, int)>& task) {
+  if (_nWorkers == 1 || nTasks <= 1) {
+    _nTasks = nTasks;
+    _nextTask = 0;
+    for (int iTask = _nextTask++; iTask < _nTasks; iTask = _nextTask++) task(iTask, 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    assert(_nBusy == 0);
+    _task = &task;
+    _nTasks = nTasks;
+    _nextTask = 0;
+    _nBusy = _nWorkers - 1;
+    _generation++;
+  }
+  _startRun.notify_all();
+  runTasks(0);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _endRun.wait(lock, [this] { return _nBusy == 0; });
+  _task = nullptr;
+}
+
+void SbtWorkerPool::work(int iWorker) {
+  unsigned int generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _startRun.wait(lock, [&] { return _quit || _generation != generation; });
+      if (_quit) return;
+      generation = _generation;
+    }
+    runTasks(iWorker);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _nBusy--;
+    }
+    _endRun.notify_one();
+  }
+}
+
+void SbtWorkerPool::runTasks(int iWorker) {
+  for (int iTask = _nextTask++; iTask < _nTasks; iTask = _nextTask++) {
+    (*_task)(iTask, iWorker);
+  }
+}
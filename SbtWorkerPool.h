@@ -0,0 +1,57 @@
+#ifndef SBTWORKERPOOL_HH
+#define SBTWORKERPOOL_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Rtypes.h>
+
+//
+// Description
+//
+// a fixed set of worker threads, started once and kept alive for the
+// lifetime of the pool, that run the tasks of the per-event loops (planes
+// to cluster, pattern recognition seeds). The calling thread is worker 0
+// and the others wait for the next call of run in between.
+
+class SbtWorkerPool {
+ public:
+  SbtWorkerPool(int nWorkers);
+  ~SbtWorkerPool();
+
+  int getNWorkers() const { return _nWorkers; }
+
+  // run task(iTask, iWorker) for iTask in [0, nTasks) and return when all
+  // of them are done. The tasks are handed out one at a time from a shared
+  // counter, so that a long task does not hold back the others
+  void run(int nTasks, const std::function<void(int, int)>& task);
+  // called by a task: no more tasks of the current run are started
+  void stop() { _nextTask = _nTasks; }
+
+ protected:
+  void work(int iWorker);
+  void runTasks(int iWorker);
+
+  int _nWorkers;
+  int _nTasks;
+  const std::function<void(int, int)>* _task;  //!
+  std::atomic<int> _nextTask;  //!
+
+  // each run is a new generation; the workers wait for it, then the
+  // caller waits for the _nBusy workers to be done with it
+  std::mutex _mutex;  //!
+  std::condition_variable _startRun;  //!
+  std::condition_variable _endRun;  //!
+  unsigned int _generation;
+  int _nBusy;
+  bool _quit;
+  std::vector<std::thread> _threads;  //!
+
+  ClassDef(SbtWorkerPool, 0);
+};
+
+#endif